@@ -0,0 +1,128 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "arena_allocator.hpp"
+#include <algorithm>
+#include <new>
+
+monotonic_arena::monotonic_arena(void * buffer, std::size_t size)
+	: initial_buffer(static_cast<char *>(buffer))
+	, initial_size(size)
+	, current(initial_buffer)
+	, end(initial_buffer + size)
+{
+}
+monotonic_arena::~monotonic_arena()
+{
+	release();
+}
+
+void monotonic_arena::release()
+{
+	while (blocks)
+	{
+		block * previous = blocks->previous;
+		::operator delete(blocks);
+		blocks = previous;
+	}
+	current = initial_buffer;
+	end = initial_buffer + initial_size;
+	next_block_size = 1024;
+}
+
+void * monotonic_arena::allocate_from_new_block(std::size_t size, std::size_t alignment)
+{
+	// the blocks double in size so that the number of heap allocations is
+	// logarithmic in the total size. the rest of the old block is wasted
+	std::size_t needed = sizeof(block) + alignment + size;
+	std::size_t block_size = std::max(next_block_size, needed);
+	block * new_block = static_cast<block *>(::operator new(block_size));
+	new_block->previous = blocks;
+	blocks = new_block;
+	next_block_size = block_size * 2;
+	current = reinterpret_cast<char *>(new_block + 1);
+	end = reinterpret_cast<char *>(new_block) + block_size;
+	return allocate(size, alignment);
+}
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include "flat_map.hpp"
+#include <string>
+
+TEST(monotonic_arena, alignment)
+{
+	monotonic_arena arena;
+	for (std::size_t alignment : { 1, 2, 4, 8, 16, 64, 1, 16 })
+	{
+		for (std::size_t size : { 1, 3, 100, 5000 })
+		{
+			void * allocated = arena.allocate(size, alignment);
+			ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(allocated) % alignment);
+			std::fill_n(static_cast<char *>(allocated), size, 'a');
+		}
+	}
+}
+TEST(monotonic_arena, buffer)
+{
+	alignas(16) char buffer[256];
+	monotonic_arena arena(buffer, sizeof(buffer));
+	char * first = static_cast<char *>(arena.allocate(100, 1));
+	char * second = static_cast<char *>(arena.allocate(100, 1));
+	ASSERT_EQ(buffer, first);
+	ASSERT_EQ(buffer + 100, second);
+	// doesn't fit any more, goes to the heap
+	char * third = static_cast<char *>(arena.allocate(100, 1));
+	ASSERT_TRUE(third < buffer || third >= buffer + sizeof(buffer));
+	arena.release();
+	ASSERT_EQ(buffer, arena.allocate(10, 1));
+}
+TEST(arena_allocator, flat_map)
+{
+	alignas(std::pair<int, std::string>) char buffer[4096];
+	monotonic_arena arena(buffer, sizeof(buffer));
+	typedef flat_map<int, std::string, std::less<int>, arena_allocator<std::pair<int, std::string> > > map_type;
+	map_type map{arena_allocator<std::pair<int, std::string> >(arena)};
+	for (int i = 0; i < 8; ++i)
+		map.emplace(7 - i, std::to_string(i));
+	ASSERT_EQ(8u, map.size());
+	ASSERT_EQ("7", map[0]);
+	ASSERT_EQ("0", map.at(7));
+	// all the elements are in the buffer, no heap allocation
+	const char * address = reinterpret_cast<const char *>(std::addressof(*map.begin()));
+	ASSERT_TRUE(address >= buffer && address < buffer + sizeof(buffer));
+	map_type copy = map;
+	ASSERT_EQ(map, copy);
+	ASSERT_TRUE(copy.get_allocator() == map.get_allocator());
+	std::vector<std::pair<int, std::string> > more{ { 10, "a" }, { 3, "b" }, { 9, "c" } };
+	copy.insert(more.begin(), more.end());
+	ASSERT_EQ(10u, copy.size());
+	ASSERT_EQ("c", copy[9]);
+	ASSERT_EQ("4", copy[3]);
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// a monotonic arena: allocating bumps a pointer, deallocating does nothing
+// and all the memory is freed at once when the arena is destroyed or
+// released. meant to be created once per request and then used for all the
+// small maps that live only as long as the request. it can start with a
+// buffer that the caller owns, like an array on the stack, and only goes to
+// the heap once that is used up
+struct monotonic_arena
+{
+	monotonic_arena() = default;
+	monotonic_arena(void * buffer, std::size_t size);
+	monotonic_arena(const monotonic_arena &) = delete;
+	monotonic_arena & operator=(const monotonic_arena &) = delete;
+	~monotonic_arena();
+
+	void * allocate(std::size_t size, std::size_t alignment)
+	{
+		std::uintptr_t position = reinterpret_cast<std::uintptr_t>(current);
+		std::uintptr_t aligned = (position + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+		if (aligned - position + size > static_cast<std::uintptr_t>(end - current)) return allocate_from_new_block(size, alignment);
+		current += aligned - position + size;
+		return reinterpret_cast<void *>(aligned);
+	}
+	// frees all the blocks from the heap and starts over at the beginning of
+	// the initial buffer. everything that was allocated is invalid after this
+	void release();
+
+private:
+	struct block
+	{
+		block * previous;
+	};
+	char * initial_buffer = nullptr;
+	std::size_t initial_size = 0;
+	char * current = nullptr;
+	char * end = nullptr;
+	block * blocks = nullptr;
+	std::size_t next_block_size = 1024;
+
+	void * allocate_from_new_block(std::size_t size, std::size_t alignment);
+};
+
+// an allocator for a monotonic_arena. copies of the allocator share the
+// arena. the allocator moves with the container on move assignment and swap,
+// so a map from one arena can be moved into a map from a different arena,
+// but the arena still has to outlive both of them
+template<typename T>
+struct arena_allocator
+{
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	explicit arena_allocator(monotonic_arena & arena)
+		: arena(&arena)
+	{
+	}
+	template<typename U>
+	arena_allocator(const arena_allocator<U> & other)
+		: arena(other.arena)
+	{
+	}
+
+	T * allocate(std::size_t n)
+	{
+		return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T *, std::size_t)
+	{
+	}
+
+	template<typename U>
+	bool operator==(const arena_allocator<U> & other) const
+	{
+		return arena == other.arena;
+	}
+	template<typename U>
+	bool operator!=(const arena_allocator<U> & other) const
+	{
+		return arena != other.arena;
+	}
+
+private:
+	template<typename U>
+	friend struct arena_allocator;
+	monotonic_arena * arena;
+};
+
+// a std::vector that allocates from an arena. to use it in a flat_map, pass
+// the allocator to the constructor:
+// monotonic_arena arena;
+// flat_map<K, V, std::less<K>, arena_allocator<std::pair<K, V> > > map{arena_allocator<std::pair<K, V> >(arena)};
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T> >;
@@ -0,0 +1,90 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "buffered_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+TEST(buffered_flat_map, same_as_flat_map)
+{
+	std::mt19937 randomness(5);
+	flat_map<int, int> expected;
+	buffered_flat_map<int, int> buffered(4);
+	for (int i = 0; i < 2000; ++i)
+	{
+		int key = static_cast<int>(randomness() % 1000);
+		auto expected_inserted = expected.emplace(key, i);
+		auto inserted = buffered.emplace(key, i);
+		ASSERT_EQ(expected_inserted.second, inserted.second);
+		ASSERT_EQ(*expected_inserted.first, *inserted.first);
+		if (i % 7 == 0)
+			ASSERT_EQ(expected.erase(key + 1), buffered.erase(key + 1));
+		int lookup = static_cast<int>(randomness() % 1000);
+		ASSERT_EQ(expected.count(lookup), buffered.count(lookup));
+		ASSERT_EQ(expected.lower_bound(lookup) == expected.end(), buffered.lower_bound(lookup) == buffered.end());
+		ASSERT_EQ(expected.size(), buffered.size());
+	}
+	ASSERT_TRUE(std::equal(expected.begin(), expected.end(), buffered.begin()));
+	ASSERT_GT(buffered.buffered(), 0u);
+	ASSERT_EQ(expected, buffered.as_flat_map());
+	ASSERT_EQ(0u, buffered.buffered());
+}
+TEST(buffered_flat_map, lookups)
+{
+	buffered_flat_map<std::string, int> map;
+	map.insert({ { "b", 2 }, { "d", 4 } });
+	map["c"] = 3;
+	map.emplace("a", 1);
+	ASSERT_EQ(2u, map.buffered());
+	ASSERT_EQ(1, map.at("a"));
+	ASSERT_EQ(2, map.at("b"));
+	ASSERT_EQ(3, map["c"]);
+	ASSERT_THROW(map.at("e"), std::out_of_range);
+	ASSERT_EQ(map.end(), map.find("e"));
+	map.find("d")->second = 5;
+	std::string keys;
+	for (const auto & kv : map)
+		keys += kv.first;
+	ASSERT_EQ("abcd", keys);
+	ASSERT_EQ(5, map.upper_bound("c")->second);
+	const buffered_flat_map<std::string, int> & const_map = map;
+	ASSERT_EQ(3, const_map.find("c")->second);
+}
+TEST(buffered_flat_map, move_only)
+{
+	buffered_flat_map<std::unique_ptr<int>, int> map(1);
+	for (int i = 0; i < 10; ++i)
+		map.emplace(std::unique_ptr<int>(new int(i)), i);
+	ASSERT_EQ(10u, map.size());
+}
+
+#endif
@@ -0,0 +1,310 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <cmath>
+#include <iterator>
+
+// a flat_map for workloads that mix inserts and lookups. a single insert
+// into a flat_map has to shift on average half of the elements. this one
+// puts new elements into a second, small flat_map instead, and merges that
+// into the big one with the batch insert once it has more than about
+// sqrt(n) elements. so an insert costs O(sqrt(n)) amortized instead of O(n).
+// lookups have to search both maps, but both are still sorted arrays.
+// iterators walk over both maps at the same time in sorted order
+template<typename K, typename V, typename Comp = std::less<K>, typename Allocator = std::allocator<std::pair<K, V> > >
+struct buffered_flat_map
+{
+	typedef flat_map<K, V, Comp, Allocator> map_type;
+	typedef typename map_type::key_type key_type;
+	typedef typename map_type::mapped_type mapped_type;
+	typedef typename map_type::value_type value_type;
+	typedef typename map_type::key_compare key_compare;
+	typedef typename map_type::value_compare value_compare;
+	typedef typename map_type::allocator_type allocator_type;
+	typedef typename map_type::size_type size_type;
+	typedef typename map_type::difference_type difference_type;
+
+	template<bool Const>
+	struct iterator_base
+	{
+		typedef std::forward_iterator_tag iterator_category;
+		typedef buffered_flat_map::value_type value_type;
+		typedef buffered_flat_map::difference_type difference_type;
+		typedef typename std::conditional<Const, const value_type &, value_type &>::type reference;
+		typedef typename std::conditional<Const, const value_type *, value_type *>::type pointer;
+		typedef typename std::conditional<Const, typename map_type::const_iterator, typename map_type::iterator>::type map_iterator;
+
+		iterator_base() = default;
+		iterator_base(map_iterator main, map_iterator main_end, map_iterator buffer, map_iterator buffer_end)
+			: main(main), main_end(main_end), buffer(buffer), buffer_end(buffer_end)
+		{
+		}
+		template<bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+		iterator_base(const iterator_base<OtherConst> & other)
+			: main(other.main), main_end(other.main_end), buffer(other.buffer), buffer_end(other.buffer_end)
+		{
+		}
+
+		reference operator*() const
+		{
+			return in_buffer() ? *buffer : *main;
+		}
+		pointer operator->() const
+		{
+			return &**this;
+		}
+		iterator_base & operator++()
+		{
+			if (in_buffer()) ++buffer;
+			else ++main;
+			return *this;
+		}
+		iterator_base operator++(int)
+		{
+			iterator_base copy(*this);
+			++*this;
+			return copy;
+		}
+		bool operator==(const iterator_base & other) const
+		{
+			return main == other.main && buffer == other.buffer;
+		}
+		bool operator!=(const iterator_base & other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		template<bool>
+		friend struct iterator_base;
+		map_iterator main;
+		map_iterator main_end;
+		map_iterator buffer;
+		map_iterator buffer_end;
+
+		bool in_buffer() const
+		{
+			return main == main_end || (buffer != buffer_end && value_compare()(*buffer, *main));
+		}
+	};
+	typedef iterator_base<false> iterator;
+	typedef iterator_base<true> const_iterator;
+
+	// the buffer gets merged when it has more than
+	// max(min_buffer_size, sqrt(size())) elements
+	explicit buffered_flat_map(size_type min_buffer_size = 64)
+		: min_buffer_size(min_buffer_size)
+	{
+	}
+	explicit buffered_flat_map(map_type map, size_type min_buffer_size = 64)
+		: main(std::move(map)), min_buffer_size(min_buffer_size)
+	{
+	}
+
+	iterator		begin()				{	return iterator(main.begin(), main.end(), buffer.begin(), buffer.end());		}
+	iterator		end()				{	return iterator(main.end(), main.end(), buffer.end(), buffer.end());			}
+	const_iterator	begin()		const	{	return const_iterator(main.begin(), main.end(), buffer.begin(), buffer.end());	}
+	const_iterator	end()		const	{	return const_iterator(main.end(), main.end(), buffer.end(), buffer.end());		}
+	const_iterator	cbegin()	const	{	return begin();	}
+	const_iterator	cend()		const	{	return end();	}
+
+	bool empty() const
+	{
+		return main.empty() && buffer.empty();
+	}
+	size_type size() const
+	{
+		return main.size() + buffer.size();
+	}
+	size_type buffered() const
+	{
+		return buffer.size();
+	}
+
+	mapped_type & operator[](const key_type & key)
+	{
+		return emplace(key, mapped_type()).first->second;
+	}
+	mapped_type & operator[](key_type && key)
+	{
+		return emplace(std::move(key), mapped_type()).first->second;
+	}
+	mapped_type & at(const key_type & key)
+	{
+		auto found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	const mapped_type & at(const key_type & key) const
+	{
+		auto found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	std::pair<iterator, bool> insert(value_type && value)
+	{
+		return emplace(std::move(value));
+	}
+	std::pair<iterator, bool> insert(const value_type & value)
+	{
+		return emplace(value);
+	}
+	// batches don't need the buffer. they go straight to the big map
+	template<typename It>
+	void insert(It begin, It end)
+	{
+		flush();
+		main.insert(begin, end);
+	}
+	void insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+	template<typename First, typename... Args>
+	std::pair<iterator, bool> emplace(First && first, Args &&... args)
+	{
+		// merge before inserting, not after, so that the returned
+		// iterator stays valid
+		if (buffer.size() >= buffer_limit()) flush();
+		auto in_main = main.lower_bound(first);
+		if (in_main != main.end() && !value_compare_or_key(first, *in_main))
+			return { iterator(in_main, main.end(), buffer.lower_bound(in_main->first), buffer.end()), false };
+		auto inserted = buffer.emplace(std::forward<First>(first), std::forward<Args>(args)...);
+		return { iterator(in_main, main.end(), inserted.first, buffer.end()), inserted.second };
+	}
+	size_type erase(const key_type & key)
+	{
+		return main.erase(key) + buffer.erase(key);
+	}
+	void swap(buffered_flat_map & other)
+	{
+		main.swap(other.main);
+		buffer.swap(other.buffer);
+		std::swap(min_buffer_size, other.min_buffer_size);
+	}
+	void clear()
+	{
+		main.clear();
+		buffer.clear();
+	}
+
+	template<typename T>
+	iterator find(const T & key)
+	{
+		auto in_main = main.lower_bound(key);
+		auto in_buffer = buffer.lower_bound(key);
+		iterator result(in_main, main.end(), in_buffer, buffer.end());
+		if (result == end() || key_compare()(key, result->first)) return end();
+		else return result;
+	}
+	template<typename T>
+	const_iterator find(const T & key) const
+	{
+		auto in_main = main.lower_bound(key);
+		auto in_buffer = buffer.lower_bound(key);
+		const_iterator result(in_main, main.end(), in_buffer, buffer.end());
+		if (result == end() || key_compare()(key, result->first)) return end();
+		else return result;
+	}
+	template<typename T>
+	size_type count(const T & key) const
+	{
+		return main.count(key) + buffer.count(key);
+	}
+	template<typename T>
+	iterator lower_bound(const T & key)
+	{
+		return iterator(main.lower_bound(key), main.end(), buffer.lower_bound(key), buffer.end());
+	}
+	template<typename T>
+	const_iterator lower_bound(const T & key) const
+	{
+		return const_iterator(main.lower_bound(key), main.end(), buffer.lower_bound(key), buffer.end());
+	}
+	template<typename T>
+	iterator upper_bound(const T & key)
+	{
+		return iterator(main.upper_bound(key), main.end(), buffer.upper_bound(key), buffer.end());
+	}
+	template<typename T>
+	const_iterator upper_bound(const T & key) const
+	{
+		return const_iterator(main.upper_bound(key), main.end(), buffer.upper_bound(key), buffer.end());
+	}
+
+	// merges the buffer into the big map. the keys in the two maps never
+	// overlap, so this is a single merge without any duplicates
+	void flush()
+	{
+		if (buffer.empty()) return;
+		main.insert(sorted_unique, std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()));
+		buffer.clear();
+	}
+	// flushes and then returns the big map, which now has all the elements
+	const map_type & as_flat_map()
+	{
+		flush();
+		return main;
+	}
+
+	bool operator==(const buffered_flat_map & other) const
+	{
+		return size() == other.size() && std::equal(begin(), end(), other.begin());
+	}
+	bool operator!=(const buffered_flat_map & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	map_type main;
+	map_type buffer;
+	size_type min_buffer_size;
+
+	size_type buffer_limit() const
+	{
+		return std::max(min_buffer_size, static_cast<size_type>(std::sqrt(static_cast<double>(main.size()))));
+	}
+	template<typename T>
+	static bool value_compare_or_key(const T & key, const value_type & value)
+	{
+		return key_compare()(key, value.first);
+	}
+	static bool value_compare_or_key(const value_type & lhs, const value_type & rhs)
+	{
+		return value_compare()(lhs, rhs);
+	}
+};
+
+template<typename K, typename V, typename C, typename A>
+void swap(buffered_flat_map<K, V, C, A> & lhs, buffered_flat_map<K, V, C, A> & rhs)
+{
+	lhs.swap(rhs);
+}
@@ -10,7 +10,13 @@ os.chdir(directory)
 
 prepare_command = 'qmake-qt4 ../compile_time.pro -r -spec unsupported/linux-clang DEFINES+=%s'
 #prepare_command += ' DEFINES+=COMPILE_UNIQUE_PTR'
+#prepare_command += ' DEFINES+=STD_UNIQUE_PTR'
+#prepare_command += ' DEFINES+=CUSTOM_DELETER'
 prepare_command += ' DEFINES+=COMPILE_FLAT_MAP'
+#prepare_command += ' DEFINES+=COMPILE_FLAT_MULTIMAP'
+#prepare_command += ' DEFINES+=COMPILE_FLAT_SET'
+#prepare_command += ' DEFINES+=COMPILE_FLAT_MULTISET'
+#prepare_command += ' DEFINES+=COMPILE_STATIC_FLAT_MAP'
 prepare_command += ' DEFINES+=BOOST_FLAT_MAP'
 clean_command = 'rm main.o'
 build_command = 'make -j4'
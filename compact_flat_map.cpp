@@ -0,0 +1,112 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "compact_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+
+TEST(compact_flat_map, integers)
+{
+	std::mt19937_64 randomness(5);
+	for (size_t size : { 0, 1, 7, 8, 9, 100, 1000 })
+	{
+		flat_map<std::int64_t, int> map;
+		while (map.size() < size)
+			map.emplace(static_cast<std::int64_t>(randomness() % 5000) - 2500, static_cast<int>(map.size()));
+		// a block with a huge distance in it
+		if (size == 100) map.emplace(std::numeric_limits<std::int64_t>::max(), -1);
+		compact_flat_map<std::int64_t, int, 8> compact(map);
+		ASSERT_EQ(map.size(), compact.size());
+		ASSERT_TRUE(std::equal(map.begin(), map.end(), compact.begin(), [](const std::pair<std::int64_t, int> & lhs, const std::pair<std::int64_t, const int &> & rhs)
+		{
+			return lhs.first == rhs.first && lhs.second == rhs.second;
+		}));
+		for (std::int64_t i = -2501; i <= 2501; ++i)
+		{
+			ASSERT_EQ(map.lower_bound(i) - map.begin(), static_cast<std::ptrdiff_t>(compact.lower_bound(i).index()));
+			ASSERT_EQ(map.upper_bound(i) - map.begin(), static_cast<std::ptrdiff_t>(compact.upper_bound(i).index()));
+			ASSERT_EQ(map.count(i), compact.count(i));
+		}
+		ASSERT_EQ(map, compact.thaw());
+	}
+}
+TEST(compact_flat_map, strings)
+{
+	std::mt19937 randomness(5);
+	const char * parts[] = { "http://", "example.com/", "a", "ab", "abc", "b", "/", "index.html", "\xff", "" };
+	for (size_t size : { 0, 1, 7, 8, 9, 100, 1000 })
+	{
+		flat_map<std::string, size_t> map;
+		while (map.size() < size)
+		{
+			std::string key;
+			for (int i = randomness() % 5; i > 0; --i)
+				key += parts[randomness() % 10];
+			map.emplace(key, map.size());
+		}
+		compact_flat_map<std::string, size_t, 8> compact(map);
+		ASSERT_EQ(map.size(), compact.size());
+		size_t index = 0;
+		for (const auto & element : compact)
+		{
+			ASSERT_EQ(map.begin()[index].first, element.first);
+			ASSERT_EQ(map.begin()[index].second, element.second);
+			ASSERT_EQ(map.begin()[index].first, compact.key_at(index));
+			++index;
+		}
+		for (int i = 0; i < 1000; ++i)
+		{
+			std::string key;
+			for (int j = randomness() % 5; j > 0; --j)
+				key += parts[randomness() % 10];
+			if (i % 2 && !key.empty()) key.pop_back();
+			ASSERT_EQ(map.lower_bound(key) - map.begin(), static_cast<std::ptrdiff_t>(compact.lower_bound(key).index()));
+			ASSERT_EQ(map.upper_bound(key) - map.begin(), static_cast<std::ptrdiff_t>(compact.upper_bound(key).index()));
+			ASSERT_EQ(map.count(key), compact.count(key));
+		}
+		ASSERT_EQ(map, compact.thaw());
+	}
+}
+TEST(compact_flat_map, lookups)
+{
+	compact_flat_map<std::string, int> compact(flat_map<std::string, int>{ { "https://a.com/x", 1 }, { "https://a.com/y", 2 }, { "https://b.com", 3 } });
+	ASSERT_EQ(2, compact.at("https://a.com/y"));
+	ASSERT_EQ(3, *compact.get("https://b.com"));
+	ASSERT_EQ(nullptr, compact.get("https://a.com/"));
+	ASSERT_THROW(compact.at("https://c.com"), std::out_of_range);
+	ASSERT_EQ("https://a.com/x", compact.find("https://a.com/x")->first);
+	ASSERT_EQ(compact.end(), compact.find("https://a.com"));
+	compact_flat_map<std::uint64_t, int> ids(flat_map<std::uint64_t, int>{ { 1000000, 1 }, { 1000007, 2 }, { 1000003, 3 } });
+	ASSERT_EQ(3, ids.at(1000003));
+	ASSERT_EQ(1000007u, ids.lower_bound(1000004)->first);
+	ASSERT_LT(ids.key_memory_usage(), 3 * sizeof(std::uint64_t) + 64);
+}
+
+#endif
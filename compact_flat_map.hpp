@@ -0,0 +1,625 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+
+namespace detail
+{
+// sorted unique integer keys, in blocks of BlockSize. every block stores its
+// first key in full, and for the other keys only the distance to the first
+// key, with as many bits as the biggest distance in the block needs. the
+// distances can be read without decoding the rest of the block, so the
+// search inside of a block is a binary search too
+template<typename K, size_t BlockSize>
+struct compact_integer_keys
+{
+	static_assert(std::is_integral<K>::value && !std::is_same<K, bool>::value, "only integer keys can be packed");
+	typedef K key_type;
+
+	compact_integer_keys() = default;
+	template<typename It>
+	compact_integer_keys(It begin, It end)
+	{
+		for (; begin != end; ++num_keys)
+		{
+			if (num_keys % BlockSize == 0)
+			{
+				// scan the block once to find out how many bits it needs
+				It block_end = begin;
+				unsigned_key max_distance = 0;
+				for (size_t i = 0; i < BlockSize && block_end != end; ++i, ++block_end)
+					max_distance = distance(*begin, *block_end);
+				first_keys.push_back(*begin);
+				blocks.push_back({ bit_position, bits_for(max_distance) });
+			}
+			const block & current = blocks.back();
+			if (num_keys % BlockSize != 0)
+			{
+				write(bit_position, current.bits, distance(first_keys.back(), *begin));
+				bit_position += current.bits;
+			}
+			++begin;
+		}
+		// one more word so that a read never has to check if it's at the end
+		words.resize(bit_position / 64 + 2);
+		words.shrink_to_fit();
+		first_keys.shrink_to_fit();
+		blocks.shrink_to_fit();
+	}
+
+	size_t size() const
+	{
+		return num_keys;
+	}
+	// the index of the first key that is not less than key. found says
+	// whether that key is equal to key
+	size_t lower_bound(K key, bool & found) const
+	{
+		found = false;
+		if (num_keys == 0) return 0;
+		size_t block_index = branchless_lower_bound(first_keys.data(), first_keys.size(), key);
+		found = block_index < first_keys.size() && first_keys[block_index] == key;
+		if (found) return block_index * BlockSize;
+		if (block_index == 0) return 0;
+		--block_index;
+		const block & current = blocks[block_index];
+		unsigned_key wanted = distance(first_keys[block_index], key);
+		// a branchless binary search over the distances of the keys 1 to
+		// block_size - 1. the key is bigger than the first key, so there
+		// is always at least one more key in the block
+		size_t num_distances = std::min(BlockSize, num_keys - block_index * BlockSize) - 1;
+		if (num_distances == 0) return block_index * BlockSize + 1;
+		size_t begin = 0;
+		for (size_t n = num_distances; n > 1;)
+		{
+			size_t half = n / 2;
+			begin = read(current.bit_position + (begin + half) * current.bits, current.bits) < wanted ? begin + half : begin;
+			n -= half;
+		}
+		begin += read(current.bit_position + begin * current.bits, current.bits) < wanted;
+		found = begin < num_distances && read(current.bit_position + begin * current.bits, current.bits) == wanted;
+		return block_index * BlockSize + begin + 1;
+	}
+	K key_at(size_t index) const
+	{
+		size_t block_index = index / BlockSize;
+		size_t in_block = index % BlockSize;
+		if (in_block == 0) return first_keys[block_index];
+		const block & current = blocks[block_index];
+		unsigned_key offset = read(current.bit_position + (in_block - 1) * current.bits, current.bits);
+		return static_cast<K>(static_cast<unsigned_key>(first_keys[block_index]) + offset);
+	}
+	size_t memory_usage() const
+	{
+		return first_keys.capacity() * sizeof(K) + blocks.capacity() * sizeof(block) + words.capacity() * sizeof(std::uint64_t);
+	}
+
+private:
+	typedef typename std::make_unsigned<K>::type unsigned_key;
+	struct block
+	{
+		size_t bit_position;
+		unsigned bits;
+	};
+	std::vector<K> first_keys;
+	std::vector<block> blocks;
+	std::vector<std::uint64_t> words;
+	size_t num_keys = 0;
+	size_t bit_position = 0;
+
+	// unsigned, so that this can't overflow
+	static unsigned_key distance(K from, K to)
+	{
+		return static_cast<unsigned_key>(static_cast<unsigned_key>(to) - static_cast<unsigned_key>(from));
+	}
+	static unsigned bits_for(unsigned_key value)
+	{
+		unsigned result = 0;
+		for (; value; value >>= 1)
+			++result;
+		return result;
+	}
+	void write(size_t position, unsigned bits, unsigned_key value)
+	{
+		if (bits == 0) return;
+		if (words.size() < position / 64 + 2) words.resize(std::max(words.size() * 2, position / 64 + 2));
+		std::uint64_t bits64 = static_cast<std::uint64_t>(value);
+		size_t word = position / 64;
+		unsigned shift = position % 64;
+		words[word] |= bits64 << shift;
+		if (shift + bits > 64) words[word + 1] |= bits64 >> (64 - shift);
+	}
+	unsigned_key read(size_t position, unsigned bits) const
+	{
+		size_t word = position / 64;
+		unsigned shift = position % 64;
+		std::uint64_t result = words[word] >> shift;
+		if (shift + bits > 64) result |= words[word + 1] << (64 - shift);
+		if (bits < 64) result &= (std::uint64_t(1) << bits) - 1;
+		return static_cast<unsigned_key>(result);
+	}
+};
+
+// sorted unique strings, front coded in blocks of BlockSize. every key is
+// stored as the length of the prefix it shares with the key before it,
+// the length of the rest, and the rest. the first key of a block doesn't
+// share anything, so a search can start there. a lookup binary searches
+// the first keys of the blocks and then scans one block
+template<size_t BlockSize>
+struct compact_string_keys
+{
+	typedef std::string key_type;
+
+	compact_string_keys() = default;
+	template<typename It>
+	compact_string_keys(It begin, It end)
+	{
+		const std::string * previous = nullptr;
+		for (; begin != end; ++begin, ++num_keys)
+		{
+			const std::string & key = *begin;
+			size_t shared = 0;
+			if (num_keys % BlockSize == 0) block_starts.push_back(bytes.size());
+			else
+			{
+				size_t max_shared = std::min(previous->size(), key.size());
+				while (shared < max_shared && (*previous)[shared] == key[shared])
+					++shared;
+			}
+			write_varint(shared);
+			write_varint(key.size() - shared);
+			bytes.insert(bytes.end(), key.begin() + shared, key.end());
+			previous = &key;
+		}
+		bytes.shrink_to_fit();
+		block_starts.shrink_to_fit();
+	}
+
+	size_t size() const
+	{
+		return num_keys;
+	}
+	size_t lower_bound(const std::string & key, bool & found) const
+	{
+		found = false;
+		// the last block whose first key is not bigger than key
+		size_t begin = 0;
+		size_t n = block_starts.size();
+		while (n > 0)
+		{
+			size_t half = n / 2;
+			const char * entry = bytes.data() + block_starts[begin + half];
+			read_varint(entry);
+			size_t length = read_varint(entry);
+			if (compare(entry, length, key.data(), key.size()) <= 0)
+			{
+				begin += half + 1;
+				n -= half + 1;
+			}
+			else n = half;
+		}
+		if (begin == 0) return 0;
+		size_t block_index = begin - 1;
+		size_t index = block_index * BlockSize;
+		size_t block_end = std::min(index + BlockSize, num_keys);
+		const char * entry = bytes.data() + block_starts[block_index];
+		// how much of the current entry is the same as key. while scanning,
+		// every entry is less than key. if an entry shares more than that
+		// with the entry before it, it has the same byte where the entry
+		// before it was smaller than key, so it is smaller too. if it shares
+		// less, it is bigger than the entry before it where that one matched
+		// key, so it is bigger than key. only if it shares exactly that much
+		// do the bytes have to be compared
+		size_t matched = 0;
+		for (; index < block_end; ++index)
+		{
+			size_t shared = read_varint(entry);
+			size_t length = read_varint(entry);
+			const char * rest = entry;
+			entry += length;
+			if (shared > matched) continue;
+			if (shared < matched) return index;
+			size_t max_matched = std::min(key.size(), shared + length);
+			while (matched < max_matched && rest[matched - shared] == key[matched])
+				++matched;
+			if (matched == key.size())
+			{
+				found = matched == shared + length;
+				return index;
+			}
+			if (matched == shared + length) continue;
+			if (static_cast<unsigned char>(rest[matched - shared]) > static_cast<unsigned char>(key[matched])) return index;
+		}
+		return index;
+	}
+	// decodes keys one after the other, for iteration
+	struct cursor
+	{
+		size_t index = 0;
+		size_t offset = 0;
+		std::string key;
+	};
+	void seek(cursor & cursor, size_t index) const
+	{
+		if (index >= num_keys)
+		{
+			cursor.index = num_keys;
+			return;
+		}
+		cursor.index = index / BlockSize * BlockSize;
+		cursor.offset = block_starts[index / BlockSize];
+		cursor.key.clear();
+		decode_next(cursor);
+		while (cursor.index < index)
+			next(cursor);
+	}
+	void next(cursor & cursor) const
+	{
+		++cursor.index;
+		if (cursor.index < num_keys) decode_next(cursor);
+	}
+	std::string key_at(size_t index) const
+	{
+		cursor result;
+		seek(result, index);
+		return std::move(result.key);
+	}
+	size_t memory_usage() const
+	{
+		return bytes.capacity() + block_starts.capacity() * sizeof(size_t);
+	}
+
+private:
+	std::vector<char> bytes;
+	std::vector<size_t> block_starts;
+	size_t num_keys = 0;
+
+	void write_varint(size_t value)
+	{
+		for (; value >= 0x80; value >>= 7)
+			bytes.push_back(static_cast<char>(value | 0x80));
+		bytes.push_back(static_cast<char>(value));
+	}
+	static size_t read_varint(const char *& it)
+	{
+		size_t result = 0;
+		for (unsigned shift = 0;; shift += 7)
+		{
+			unsigned char byte = static_cast<unsigned char>(*it++);
+			result |= static_cast<size_t>(byte & 0x7f) << shift;
+			if (byte < 0x80) return result;
+		}
+	}
+	// like std::string::compare
+	static int compare(const char * lhs, size_t lhs_size, const char * rhs, size_t rhs_size)
+	{
+		int result = std::memcmp(lhs, rhs, std::min(lhs_size, rhs_size));
+		if (result != 0) return result;
+		return lhs_size < rhs_size ? -1 : lhs_size > rhs_size;
+	}
+	// the cursor's key is the key before this entry, or empty at the
+	// start of a block
+	void decode_next(cursor & cursor) const
+	{
+		const char * entry = bytes.data() + cursor.offset;
+		size_t shared = read_varint(entry);
+		size_t length = read_varint(entry);
+		cursor.key.resize(shared);
+		cursor.key.append(entry, length);
+		cursor.offset = entry + length - bytes.data();
+	}
+};
+
+template<typename K, size_t BlockSize>
+struct compact_keys_for
+{
+	typedef compact_integer_keys<K, BlockSize> type;
+};
+template<size_t BlockSize>
+struct compact_keys_for<std::string, BlockSize>
+{
+	typedef compact_string_keys<BlockSize> type;
+};
+}
+
+// a read-only flat_map that stores its keys compressed, for big tables of
+// integer ids or of strings like URLs. the keys are split into blocks of
+// BlockSize. integer keys store the distance to the first key of their
+// block with as few bits as possible, string keys store only what they
+// don't share with the key before them. a lookup binary searches the first
+// keys of the blocks and then only looks at one block. the values are in
+// a separate array, uncompressed.
+//
+// iterators decode the keys as they go, so they return pairs by value, with
+// a copy of the key and a reference to the value. with string keys,
+// jumping to an element (lower_bound, find) has to decode up to BlockSize
+// keys. only std::less is supported, which is what the blocks are sorted by
+template<typename K, typename V, size_t BlockSize = 64>
+struct compact_flat_map
+{
+	static_assert(BlockSize > 0, "blocks can't be empty");
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<K, const V &> value_type;
+	typedef std::less<K> key_compare;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef flat_map<K, V> map_type;
+
+private:
+	// integer keys can be decoded directly, string keys are decoded by a
+	// cursor that remembers the key before
+	struct index_cursor
+	{
+		size_t index = 0;
+	};
+	typedef typename std::conditional<std::is_same<K, std::string>::value, typename detail::compact_string_keys<BlockSize>::cursor, index_cursor>::type cursor;
+
+public:
+	struct const_iterator
+	{
+		typedef std::forward_iterator_tag iterator_category;
+		typedef compact_flat_map::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef value_type reference;
+		struct pointer
+		{
+			value_type value;
+			const value_type * operator->() const
+			{
+				return &value;
+			}
+		};
+
+		const_iterator() = default;
+		const_iterator(const compact_flat_map * map, size_t index)
+			: map(map)
+		{
+			map->seek(position, index);
+		}
+
+		value_type operator*() const
+		{
+			return { map->current_key(position), map->values[position.index] };
+		}
+		pointer operator->() const
+		{
+			return { **this };
+		}
+		const_iterator & operator++()
+		{
+			map->next(position);
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator copy(*this);
+			++*this;
+			return copy;
+		}
+		bool operator==(const const_iterator & other) const
+		{
+			return position.index == other.position.index;
+		}
+		bool operator!=(const const_iterator & other) const
+		{
+			return !(*this == other);
+		}
+		size_t index() const
+		{
+			return position.index;
+		}
+
+	private:
+		const compact_flat_map * map = nullptr;
+		cursor position;
+	};
+	typedef const_iterator iterator;
+
+	compact_flat_map() = default;
+	explicit compact_flat_map(const map_type & map)
+		: keys(key_iterator<typename map_type::const_iterator>(map.begin()), key_iterator<typename map_type::const_iterator>(map.end()))
+	{
+		values.reserve(map.size());
+		for (const auto & element : map)
+			values.push_back(element.second);
+	}
+	explicit compact_flat_map(map_type && map)
+		: keys(key_iterator<typename map_type::const_iterator>(map.cbegin()), key_iterator<typename map_type::const_iterator>(map.cend()))
+	{
+		values.reserve(map.size());
+		for (auto & element : map)
+			values.push_back(std::move(element.second));
+		map.clear();
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+	const_iterator end() const
+	{
+		return const_iterator(this, size());
+	}
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+	bool empty() const
+	{
+		return values.empty();
+	}
+	size_type size() const
+	{
+		return values.size();
+	}
+
+	// these don't decode the key, so they are the fast way to do lookups
+	const mapped_type & at(const key_type & key) const
+	{
+		size_type index = find_index(key);
+		if (index == size()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return values[index];
+	}
+	const mapped_type * get(const key_type & key) const
+	{
+		size_type index = find_index(key);
+		return index == size() ? nullptr : &values[index];
+	}
+	size_type count(const key_type & key) const
+	{
+		return find_index(key) == size() ? 0 : 1;
+	}
+
+	const_iterator find(const key_type & key) const
+	{
+		return const_iterator(this, find_index(key));
+	}
+	const_iterator lower_bound(const key_type & key) const
+	{
+		bool found;
+		return const_iterator(this, keys.lower_bound(key, found));
+	}
+	const_iterator upper_bound(const key_type & key) const
+	{
+		bool found;
+		size_type index = keys.lower_bound(key, found);
+		return const_iterator(this, index + found);
+	}
+	key_type key_at(size_type index) const
+	{
+		return keys.key_at(index);
+	}
+
+	// bytes used for the keys and values, not counting memory that the
+	// keys or values allocate themselves
+	size_type memory_usage() const
+	{
+		return keys.memory_usage() + values.capacity() * sizeof(V);
+	}
+	size_type key_memory_usage() const
+	{
+		return keys.memory_usage();
+	}
+
+	// decompresses everything into a normal flat_map
+	map_type thaw() const
+	{
+		typename map_type::container_type elements;
+		elements.reserve(size());
+		for (const_iterator it = begin(); it != end(); ++it)
+			elements.emplace_back(it->first, it->second);
+		return map_type(sorted_unique, std::move(elements));
+	}
+
+private:
+	typedef typename detail::compact_keys_for<K, BlockSize>::type keys_type;
+	keys_type keys;
+	std::vector<V> values;
+
+	template<typename It>
+	struct key_iterator
+	{
+		typedef std::forward_iterator_tag iterator_category;
+		typedef K value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const K * pointer;
+		typedef const K & reference;
+
+		explicit key_iterator(It it)
+			: it(it)
+		{
+		}
+		const K & operator*() const
+		{
+			return it->first;
+		}
+		key_iterator & operator++()
+		{
+			++it;
+			return *this;
+		}
+		bool operator==(const key_iterator & other) const
+		{
+			return it == other.it;
+		}
+		bool operator!=(const key_iterator & other) const
+		{
+			return it != other.it;
+		}
+
+	private:
+		It it;
+	};
+
+	size_type find_index(const key_type & key) const
+	{
+		bool found;
+		size_type index = keys.lower_bound(key, found);
+		return found ? index : size();
+	}
+
+	void seek(index_cursor & cursor, size_t index) const
+	{
+		cursor.index = index;
+	}
+	void next(index_cursor & cursor) const
+	{
+		++cursor.index;
+	}
+	K current_key(const index_cursor & cursor) const
+	{
+		return keys.key_at(cursor.index);
+	}
+	template<typename Cursor>
+	void seek(Cursor & cursor, size_t index) const
+	{
+		keys.seek(cursor, index);
+	}
+	template<typename Cursor>
+	void next(Cursor & cursor) const
+	{
+		keys.next(cursor);
+	}
+	template<typename Cursor>
+	const K & current_key(const Cursor & cursor) const
+	{
+		return cursor.key;
+	}
+};
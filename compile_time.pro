@@ -4,7 +4,25 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += main.cpp \
+    arena_allocator.cpp \
+    buffered_flat_map.cpp \
+    compact_flat_map.cpp \
+    dunique_ptr.cpp \
     flat_map.cpp \
+    flat_map_algorithm.cpp \
+    flat_map_parallel.cpp \
+    flat_map_statistics.cpp \
+    flat_set.cpp \
+    frozen_flat_map.cpp \
+    hashed_flat_map.cpp \
+    learned_flat_map.cpp \
+    mapped_flat_map.cpp \
+    sharded_flat_map.cpp \
+    small_vector.cpp \
+    snapshot_flat_map.cpp \
+    soa_flat_map.cpp \
+    static_flat_map.cpp \
+    tiered_vector.cpp \
     await/await.cpp \
     await/boost_await.cpp \
     await/coroutine.cpp \
@@ -13,8 +31,26 @@ SOURCES += main.cpp \
     await/then_future.cpp
 
 HEADERS += \
+    arena_allocator.hpp \
+    buffered_flat_map.hpp \
+    compact_flat_map.hpp \
     dunique_ptr.hpp \
     flat_map.hpp \
+    flat_map_algorithm.hpp \
+    flat_map_parallel.hpp \
+    flat_map_statistics.hpp \
+    flat_map_search.hpp \
+    flat_set.hpp \
+    frozen_flat_map.hpp \
+    hashed_flat_map.hpp \
+    learned_flat_map.hpp \
+    mapped_flat_map.hpp \
+    sharded_flat_map.hpp \
+    small_vector.hpp \
+    snapshot_flat_map.hpp \
+    soa_flat_map.hpp \
+    static_flat_map.hpp \
+    tiered_vector.hpp \
     await/await.h \
     await/boost_await.h \
     await/coroutine.h \
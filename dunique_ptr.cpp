@@ -0,0 +1,156 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+#include "dunique_ptr.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+struct close_file
+{
+	void operator()(std::FILE * file) const
+	{
+		std::fclose(file);
+	}
+};
+// hands out ints and takes them back
+struct int_pool
+{
+	std::vector<int *> free_list;
+	int in_use = 0;
+
+	int * get()
+	{
+		++in_use;
+		if (free_list.empty()) return new int();
+		int * result = free_list.back();
+		free_list.pop_back();
+		return result;
+	}
+	~int_pool()
+	{
+		for (int * ptr : free_list)
+			delete ptr;
+	}
+};
+struct return_to_pool
+{
+	int_pool * pool;
+	void operator()(int * ptr) const
+	{
+		--pool->in_use;
+		pool->free_list.push_back(ptr);
+	}
+};
+// a file descriptor with -1 as the empty value
+struct fd_handle
+{
+	int fd = -1;
+	fd_handle() = default;
+	fd_handle(std::nullptr_t)
+	{
+	}
+	explicit fd_handle(int fd)
+		: fd(fd)
+	{
+	}
+	bool operator==(const fd_handle & other) const
+	{
+		return fd == other.fd;
+	}
+	bool operator!=(const fd_handle & other) const
+	{
+		return fd != other.fd;
+	}
+};
+struct close_fd
+{
+	typedef fd_handle pointer;
+	void operator()(fd_handle handle) const
+	{
+		::close(handle.fd);
+	}
+};
+}
+
+static_assert(sizeof(dunique_ptr<std::FILE, close_file>) == sizeof(std::FILE *), "a deleter without state should take no space");
+static_assert(sizeof(dunique_ptr<int, return_to_pool>) == 2 * sizeof(int *), "a deleter with state is stored inline");
+
+TEST(dunique_ptr, stateless_deleter)
+{
+	dunique_ptr<std::FILE, close_file> file(std::tmpfile());
+	ASSERT_TRUE(bool(file));
+	ASSERT_EQ(1, std::fputs("a", file.get()));
+	dunique_ptr<std::FILE, close_file> moved(std::move(file));
+	ASSERT_FALSE(bool(file));
+	ASSERT_TRUE(bool(moved));
+	// an empty pointer doesn't call the deleter, fclose(nullptr) would crash
+	moved.reset();
+	file.reset();
+}
+TEST(dunique_ptr, stateful_deleter)
+{
+	int_pool pool;
+	{
+		dunique_ptr<int, return_to_pool> a(pool.get(), return_to_pool{ &pool });
+		dunique_ptr<int, return_to_pool> b(pool.get(), return_to_pool{ &pool });
+		ASSERT_EQ(2, pool.in_use);
+		*a = 5;
+		a = std::move(b);
+		ASSERT_EQ(&pool, a.get_deleter().pool);
+		ASSERT_EQ(2, pool.in_use);
+		b.reset();
+		ASSERT_EQ(1, pool.in_use);
+		int * released = a.release();
+		ASSERT_EQ(1, pool.in_use);
+		a.reset(released);
+	}
+	ASSERT_EQ(0, pool.in_use);
+	ASSERT_EQ(2u, pool.free_list.size());
+}
+TEST(dunique_ptr, handle)
+{
+	int fds[2];
+	ASSERT_EQ(0, ::pipe(fds));
+	dunique_ptr<void, close_fd> read_end(fd_handle{ fds[0] });
+	dunique_ptr<void, close_fd> write_end(fd_handle{ fds[1] });
+	ASSERT_EQ(1, ::write(write_end.get().fd, "x", 1));
+	write_end.reset();
+	char buffer[2];
+	ASSERT_EQ(1, ::read(read_end.get().fd, buffer, 2));
+	// the write end is closed, so this is the end of the file
+	ASSERT_EQ(0, ::read(read_end.get().fd, buffer, 2));
+	ASSERT_FALSE(bool(write_end));
+	ASSERT_EQ(fds[0], read_end.release().fd);
+	::close(fds[0]);
+}
+
+#endif
@@ -29,11 +29,173 @@ For more information, please refer to <http://unlicense.org/>
 
 #include <memory>
 
+namespace detail
+{
+// holds the deleter of a dunique_ptr. a deleter without state is a base
+// class so that it takes up no space
+template<typename Delete, bool = std::is_empty<Delete>::value && !std::is_final<Delete>::value>
+struct dunique_ptr_deleter : private Delete
+{
+	dunique_ptr_deleter() = default;
+	explicit dunique_ptr_deleter(Delete deleter)
+		: Delete(std::move(deleter))
+	{
+	}
+	Delete & get_deleter()
+	{
+		return *this;
+	}
+	const Delete & get_deleter() const
+	{
+		return *this;
+	}
+};
+template<typename Delete>
+struct dunique_ptr_deleter<Delete, false>
+{
+	dunique_ptr_deleter() = default;
+	explicit dunique_ptr_deleter(Delete deleter)
+		: deleter(std::move(deleter))
+	{
+	}
+	Delete & get_deleter()
+	{
+		return deleter;
+	}
+	const Delete & get_deleter() const
+	{
+		return deleter;
+	}
+
+private:
+	Delete deleter;
+};
+// Delete::pointer if there is one, T * otherwise
+template<typename T, typename Delete, typename = void>
+struct dunique_ptr_pointer
+{
+	typedef T * type;
+};
+template<typename T>
+struct dunique_ptr_void
+{
+	typedef void type;
+};
+template<typename T, typename Delete>
+struct dunique_ptr_pointer<T, Delete, typename dunique_ptr_void<typename Delete::pointer>::type>
+{
+	typedef typename Delete::pointer type;
+};
+}
+
 // behaves pretty much like std::unique_ptr but compiles
-// faster than the libstdc++ version. this doesn't
-// support a custom deleter though
+// faster than the libstdc++ version. the version with
+// std::default_delete is at the bottom, this one is for
+// custom deleters, like one that gives objects back to
+// a pool or one that calls fclose. Delete can have a
+// pointer typedef for handles that are not pointers,
+// like file descriptors, in which case pointer() is
+// the empty value. the deleter is only called if the
+// pointer is not empty
 template<typename T, typename Delete = std::default_delete<T> >
-struct dunique_ptr;
+struct dunique_ptr : private detail::dunique_ptr_deleter<Delete>
+{
+	static_assert(!std::is_reference<Delete>::value, "the deleter has to be stored by value");
+	typedef typename detail::dunique_ptr_pointer<T, Delete>::type pointer;
+	typedef T element_type;
+	typedef Delete deleter_type;
+
+	dunique_ptr()
+		: ptr()
+	{
+	}
+	explicit dunique_ptr(pointer ptr)
+		: ptr(ptr)
+	{
+	}
+	dunique_ptr(pointer ptr, Delete deleter)
+		: detail::dunique_ptr_deleter<Delete>(std::move(deleter)), ptr(ptr)
+	{
+	}
+	dunique_ptr(const dunique_ptr &) = delete;
+	dunique_ptr & operator=(const dunique_ptr &) = delete;
+	dunique_ptr(dunique_ptr && other)
+		: detail::dunique_ptr_deleter<Delete>(std::move(other.get_deleter())), ptr(other.release())
+	{
+	}
+	dunique_ptr & operator=(dunique_ptr && other)
+	{
+		swap(other);
+		return *this;
+	}
+	~dunique_ptr()
+	{
+		reset();
+	}
+	void reset(pointer value = pointer())
+	{
+		pointer to_delete = ptr;
+		ptr = value;
+		if (to_delete != pointer()) get_deleter()(to_delete);
+	}
+	pointer release()
+	{
+		pointer result = ptr;
+		ptr = pointer();
+		return result;
+	}
+	explicit operator bool() const
+	{
+		return ptr != pointer();
+	}
+	pointer get() const
+	{
+		return ptr;
+	}
+	using detail::dunique_ptr_deleter<Delete>::get_deleter;
+	typename std::add_lvalue_reference<T>::type operator*() const
+	{
+		return *ptr;
+	}
+	pointer operator->() const
+	{
+		return ptr;
+	}
+	void swap(dunique_ptr & other)
+	{
+		using std::swap;
+		swap(get_deleter(), other.get_deleter());
+		swap(ptr, other.ptr);
+	}
+
+	bool operator==(const dunique_ptr & other) const
+	{
+		return ptr == other.ptr;
+	}
+	bool operator!=(const dunique_ptr & other) const
+	{
+		return !(*this == other);
+	}
+	bool operator<(const dunique_ptr & other) const
+	{
+		return ptr < other.ptr;
+	}
+	bool operator<=(const dunique_ptr & other) const
+	{
+		return !(other < *this);
+	}
+	bool operator>(const dunique_ptr & other) const
+	{
+		return other < *this;
+	}
+	bool operator>=(const dunique_ptr & other) const
+	{
+		return !(*this < other);
+	}
+
+private:
+	pointer ptr;
+};
 
 template<typename T>
 struct dunique_ptr<T, std::default_delete<T> >
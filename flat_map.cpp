@@ -26,6 +26,7 @@ For more information, please refer to <http://unlicense.org/>
  */
 
 #include "flat_map.hpp"
+#include <stdexcept>
 
 namespace detail
 {
@@ -140,6 +141,397 @@ TEST(flat_map, insert_keep_order)
 	}
 }
 
+namespace
+{
+template<typename K>
+void check_branchless_search(std::vector<K> keys)
+{
+	std::sort(keys.begin(), keys.end());
+	flat_map<K, int> map;
+	for (const K & key : keys)
+		map.emplace(key, 0);
+	for (size_t size = 0; size <= keys.size(); ++size)
+	{
+		for (const K & key : keys)
+		{
+			size_t expected = std::lower_bound(keys.begin(), keys.begin() + size, key) - keys.begin();
+			ASSERT_EQ(expected, detail::branchless_lower_bound(keys.data(), size, key));
+		}
+	}
+	for (const K & key : keys)
+	{
+		auto expected = std::lower_bound(map.begin(), map.end(), std::make_pair(key, 0), map.value_comp());
+		ASSERT_EQ(expected, map.lower_bound(key));
+		ASSERT_EQ(expected, map.find(key));
+		ASSERT_EQ(1u, map.count(key));
+	}
+}
+}
+
+TEST(flat_map, branchless_search)
+{
+	static_assert(use_branchless_search<int, std::less<int> >::value, "int keys should use the branchless search");
+	static_assert(!use_branchless_search<int, std::greater<int> >::value, "only std::less is supported");
+	static_assert(!use_branchless_search<std::string, std::less<std::string> >::value, "only arithmetic keys are supported");
+	std::vector<int> ints;
+	std::vector<unsigned> unsigneds;
+	std::vector<std::int64_t> int64s;
+	std::vector<std::uint64_t> uint64s;
+	std::vector<float> floats;
+	std::vector<double> doubles;
+	std::vector<short> shorts;
+	for (int i = -40; i < 40; ++i)
+	{
+		// multiply so that there are gaps to search for, and so that the
+		// unsigned numbers use the high bit
+		ints.push_back(i * 3);
+		unsigneds.push_back(static_cast<unsigned>(i) * 100000000u);
+		int64s.push_back(i * 3000000000ll);
+		uint64s.push_back(static_cast<std::uint64_t>(i * 3000000000ll));
+		floats.push_back(i * 0.5f);
+		doubles.push_back(i * 0.25);
+		shorts.push_back(static_cast<short>(i * 7));
+	}
+	check_branchless_search(ints);
+	check_branchless_search(unsigneds);
+	check_branchless_search(int64s);
+	check_branchless_search(uint64s);
+	check_branchless_search(floats);
+	check_branchless_search(doubles);
+	check_branchless_search(shorts);
+}
+TEST(flat_map, branchless_search_missing_keys)
+{
+	flat_map<int, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.emplace(i * 2, i);
+	for (int i = -1; i < 201; i += 2)
+	{
+		ASSERT_EQ(map.end(), map.find(i));
+		ASSERT_EQ(0u, map.count(i));
+		ASSERT_THROW(map.at(i), std::out_of_range);
+		ASSERT_EQ(i < 0 ? 0 : (i + 1) / 2, map.lower_bound(i) - map.begin());
+	}
+	ASSERT_EQ(25, map.at(50));
+}
+
+TEST(flat_map, find_many)
+{
+	flat_map<int, int> map;
+	for (int i = 0; i < 1000; ++i)
+		map.emplace(i * 3, i);
+	std::vector<int> keys;
+	for (int i = -5; i < 3005; ++i)
+		keys.push_back((i * 7919) % 3010);
+	std::vector<flat_map<int, int>::iterator> found;
+	map.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+	std::vector<flat_map<int, int>::const_iterator> lower;
+	const flat_map<int, int> & const_map = map;
+	const_map.lower_bound_many(keys.begin(), keys.end(), std::back_inserter(lower));
+	ASSERT_EQ(keys.size(), found.size());
+	ASSERT_EQ(keys.size(), lower.size());
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		ASSERT_EQ(map.find(keys[i]), found[i]);
+		ASSERT_EQ(map.lower_bound(keys[i]), lower[i]);
+	}
+
+	// sorted keys use a different code path
+	std::sort(keys.begin(), keys.end());
+	found.clear();
+	lower.clear();
+	map.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+	const_map.lower_bound_many(keys.begin(), keys.end(), std::back_inserter(lower));
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		ASSERT_EQ(map.find(keys[i]), found[i]);
+		ASSERT_EQ(map.lower_bound(keys[i]), lower[i]);
+	}
+}
+TEST(flat_map, find_many_small)
+{
+	flat_map<std::string, int> map;
+	std::vector<std::string> keys = { "b", "a", "c" };
+	std::vector<flat_map<std::string, int>::iterator> found(3);
+	map.find_many(keys.begin(), keys.end(), found.begin());
+	ASSERT_EQ((std::vector<flat_map<std::string, int>::iterator>(3, map.end())), found);
+	map = { { "b", 2 } };
+	map.find_many(keys.begin(), keys.end(), found.begin());
+	ASSERT_EQ((std::vector<flat_map<std::string, int>::iterator>{ map.begin(), map.end(), map.end() }), found);
+}
+
+TEST(flat_map, sorted_unique)
+{
+	std::vector<std::pair<int, int> > sorted{ { 1, 1 }, { 3, 3 }, { 5, 5 } };
+	flat_map<int, int> foo(sorted_unique, sorted.begin(), sorted.end());
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 3, 3 }, { 5, 5 } }), foo);
+	std::vector<std::pair<int, int> > after{ { 6, 6 }, { 7, 7 } };
+	foo.insert(sorted_unique, after.begin(), after.end());
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 3, 3 }, { 5, 5 }, { 6, 6 }, { 7, 7 } }), foo);
+	std::vector<std::pair<int, int> > overlapping{ { 0, 0 }, { 3, 4 }, { 4, 4 }, { 8, 8 } };
+	foo.insert(sorted_unique, overlapping.begin(), overlapping.end());
+	ASSERT_EQ((flat_map<int, int>{ { 0, 0 }, { 1, 1 }, { 3, 3 }, { 4, 4 }, { 5, 5 }, { 6, 6 }, { 7, 7 }, { 8, 8 } }), foo);
+}
+TEST(flat_map, sorted_equivalent)
+{
+	std::vector<std::pair<int, int> > sorted{ { 1, 1 }, { 1, 2 }, { 3, 3 }, { 3, 4 }, { 5, 5 } };
+	flat_map<int, int> foo(sorted_equivalent, sorted.begin(), sorted.end());
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 3, 3 }, { 5, 5 } }), foo);
+	std::vector<std::pair<int, int> > more{ { 2, 2 }, { 2, 3 }, { 5, 6 }, { 6, 6 }, { 6, 7 } };
+	foo.insert(sorted_equivalent, more.begin(), more.end());
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 2, 2 }, { 3, 3 }, { 5, 5 }, { 6, 6 } }), foo);
+	std::vector<std::pair<int, int> > after{ { 7, 7 }, { 7, 8 } };
+	foo.insert(sorted_equivalent, after.begin(), after.end());
+	ASSERT_EQ(6u, foo.size());
+	ASSERT_EQ(7, foo[7]);
+}
+TEST(flat_map, adopt_container)
+{
+	flat_map<int, int>::container_type sorted{ { 1, 1 }, { 3, 3 } };
+	const std::pair<int, int> * data = sorted.data();
+	flat_map<int, int> foo(sorted_unique, std::move(sorted));
+	ASSERT_EQ(data, &*foo.begin());
+	ASSERT_EQ(3, foo[3]);
+	flat_map<int, int>::container_type extracted = std::move(foo).extract();
+	ASSERT_TRUE(foo.empty());
+	ASSERT_EQ(data, extracted.data());
+	extracted.emplace_back(4, 4);
+	foo.replace(std::move(extracted));
+	ASSERT_EQ(4, foo.at(4));
+
+	flat_map<int, int> unsorted(flat_map<int, int>::container_type{ { 3, 3 }, { 1, 1 }, { 3, 4 } });
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 3, 3 } }), unsorted);
+}
+
+#include <limits>
+#include <random>
+#include <string>
+namespace
+{
+// compares every search policy against std::lower_bound and std::upper_bound
+// on the same sorted keys, for every size up to keys.size()
+template<typename Search, typename K>
+void check_search_policy(const std::vector<K> & sorted_keys, const std::vector<K> & lookups)
+{
+	for (size_t size : { size_t(0), size_t(1), size_t(2), size_t(15), size_t(16), size_t(17), sorted_keys.size() })
+	{
+		size = std::min(size, sorted_keys.size());
+		flat_map<K, int, std::less<K>, std::allocator<std::pair<K, int> >, Search> map;
+		flat_multimap<K, int, std::less<K>, std::allocator<std::pair<K, int> >, Search> multimap;
+		for (size_t i = 0; i < size; ++i)
+		{
+			map.emplace(sorted_keys[i], 0);
+			multimap.emplace(sorted_keys[i], 0);
+			multimap.emplace(sorted_keys[i], 1);
+		}
+		std::vector<K> keys(map.size());
+		std::transform(map.begin(), map.end(), keys.begin(), [](const std::pair<K, int> & pair){ return pair.first; });
+		for (const K & key : lookups)
+		{
+			size_t lower = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+			size_t upper = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+			ASSERT_EQ(lower, size_t(map.lower_bound(key) - map.begin()));
+			ASSERT_EQ(upper, size_t(map.upper_bound(key) - map.begin()));
+			ASSERT_EQ(upper - lower, map.count(key));
+			ASSERT_EQ(lower * 2, size_t(multimap.lower_bound(key) - multimap.begin()));
+			ASSERT_EQ(upper * 2, size_t(multimap.upper_bound(key) - multimap.begin()));
+			ASSERT_EQ((upper - lower) * 2, multimap.count(key));
+		}
+	}
+}
+template<typename Search>
+void check_search_policy()
+{
+	std::mt19937_64 randomness(5);
+	std::vector<int> dense;
+	std::vector<std::int64_t> uniform;
+	std::vector<double> skewed;
+	std::vector<std::string> strings;
+	for (int i = 0; i < 300; ++i)
+	{
+		dense.push_back(i * 2);
+		uniform.push_back(static_cast<std::int64_t>(randomness() >> 2));
+		// most keys are tiny and a few are huge, which is the worst case
+		// for the interpolation search
+		skewed.push_back(i < 290 ? i * 0.001 : i * 1e12);
+		strings.push_back(std::to_string(i * 2));
+	}
+	std::sort(uniform.begin(), uniform.end());
+	std::sort(strings.begin(), strings.end());
+	std::vector<int> dense_lookups;
+	for (int i = -3; i < 605; ++i)
+		dense_lookups.push_back(i);
+	check_search_policy<Search>(dense, dense_lookups);
+	std::vector<std::int64_t> uniform_lookups = uniform;
+	for (std::int64_t key : uniform)
+		uniform_lookups.push_back(key + 1);
+	uniform_lookups.push_back(std::numeric_limits<std::int64_t>::min());
+	uniform_lookups.push_back(std::numeric_limits<std::int64_t>::max());
+	check_search_policy<Search>(uniform, uniform_lookups);
+	std::vector<double> skewed_lookups = skewed;
+	for (double key : skewed)
+		skewed_lookups.push_back(key + 0.0005);
+	check_search_policy<Search>(skewed, skewed_lookups);
+	std::vector<std::string> string_lookups = strings;
+	for (int i = -1; i < 601; i += 2)
+		string_lookups.push_back(std::to_string(i));
+	check_search_policy<Search>(strings, string_lookups);
+}
+}
+
+TEST(flat_map, search_policies)
+{
+	check_search_policy<std_search>();
+	check_search_policy<linear_search>();
+	check_search_policy<branchless_search>();
+	check_search_policy<interpolation_search>();
+	check_search_policy<adaptive_search>();
+}
+
+TEST(flat_map, erase_if)
+{
+	flat_map<int, std::unique_ptr<int> > foo;
+	for (int i = 0; i < 10; ++i)
+		foo.emplace(i, std::unique_ptr<int>(new int(i * 10)));
+	ASSERT_EQ(5u, foo.erase_if([](const std::pair<int, std::unique_ptr<int> > & pair){ return pair.first % 2 == 1; }));
+	ASSERT_EQ(5u, foo.size());
+	ASSERT_EQ(40, *foo[4]);
+	ASSERT_EQ(0u, foo.count(5));
+	ASSERT_EQ(2u, foo.retain([](const std::pair<int, std::unique_ptr<int> > & pair){ return *pair.second < 50; }));
+	ASSERT_EQ(3u, foo.size());
+	ASSERT_EQ(20, *foo.at(2));
+	ASSERT_EQ(0u, foo.erase_if([](const std::pair<int, std::unique_ptr<int> > &){ return false; }));
+	ASSERT_EQ(3u, foo.size());
+}
+TEST(flat_map, erase_keys)
+{
+	flat_map<int, std::string> foo;
+	for (int i = 0; i < 20; ++i)
+		foo.emplace(i * 2, std::to_string(i));
+	std::vector<int> keys{ -1, 4, 4, 5, 6, 30, 38, 39, 100 };
+	ASSERT_EQ(4u, foo.erase_keys(keys.begin(), keys.end()));
+	ASSERT_EQ(16u, foo.size());
+	for (int key : keys)
+		ASSERT_EQ(0u, foo.count(key));
+	ASSERT_EQ("1", foo[2]);
+	ASSERT_EQ("4", foo[8]);
+	ASSERT_EQ("18", foo[36]);
+	ASSERT_EQ(0u, foo.erase_keys(keys.begin(), keys.begin()));
+	ASSERT_EQ(0u, foo.erase_keys(keys.begin(), keys.end()));
+	// erasing only from the front still moves the rest into place
+	std::vector<int> front{ 0, 2 };
+	ASSERT_EQ(2u, foo.erase_keys(front.begin(), front.end()));
+	ASSERT_EQ("4", foo.begin()->second);
+	ASSERT_EQ("18", foo.rbegin()->second);
+	ASSERT_EQ(14u, foo.size());
+	// same as erasing one at a time
+	std::mt19937 randomness(5);
+	flat_map<int, int> random;
+	for (int i = 0; i < 1000; ++i)
+		random.emplace(randomness() % 2000, i);
+	flat_map<int, int> one_at_a_time = random;
+	std::vector<int> random_keys;
+	for (int i = 0; i < 500; ++i)
+		random_keys.push_back(randomness() % 2000);
+	std::sort(random_keys.begin(), random_keys.end());
+	size_t num_erased = 0;
+	for (int key : random_keys)
+		num_erased += one_at_a_time.erase(key);
+	ASSERT_EQ(num_erased, random.erase_keys(random_keys.begin(), random_keys.end()));
+	ASSERT_EQ(one_at_a_time, random);
+}
+TEST(flat_map, merge_updates)
+{
+	flat_map<int, int> counts = { { 1, 10 }, { 3, 30 }, { 5, 50 } };
+	std::vector<std::pair<int, int> > updates = { { 5, 1 }, { 0, 1 }, { 3, 1 }, { 6, 1 }, { 0, 2 }, { 5, 2 } };
+	counts.merge_updates(updates.begin(), updates.end(), std::plus<int>());
+	ASSERT_EQ((flat_map<int, int>{ { 0, 3 }, { 1, 10 }, { 3, 31 }, { 5, 53 }, { 6, 1 } }), counts);
+	// repeated keys are combined in the order of the batch
+	flat_map<int, std::string> log = { { 2, "a" } };
+	std::vector<std::pair<int, std::string> > sorted = { { 1, "b" }, { 1, "c" }, { 2, "d" }, { 2, "e" }, { 4, "f" } };
+	log.merge_updates(sorted_equivalent, sorted.begin(), sorted.end(), [](std::string existing, const std::string & incoming)
+	{
+		return existing + incoming;
+	});
+	ASSERT_EQ((flat_map<int, std::string>{ { 1, "bc" }, { 2, "ade" }, { 4, "f" } }), log);
+	// if combine throws, no new keys get inserted
+	std::vector<std::pair<int, std::string> > throwing = { { 0, "x" }, { 1, "y" } };
+	ASSERT_THROW(log.merge_updates(sorted_equivalent, throwing.begin(), throwing.end(), [](std::string, const std::string &) -> std::string
+	{
+		throw std::runtime_error("combine");
+	}), std::runtime_error);
+	ASSERT_EQ(3u, log.size());
+	ASSERT_EQ(0u, log.count(0));
+	// same as a find and a write for every update, for dense and for sparse batches
+	std::mt19937 randomness(5);
+	for (size_t batch_size : { 1, 10, 1000, 5000 })
+	{
+		flat_map<int, int> random;
+		for (int i = 0; i < 1000; ++i)
+			random.emplace(randomness() % 5000, i);
+		flat_map<int, int> one_at_a_time = random;
+		std::vector<std::pair<int, int> > batch;
+		for (size_t i = 0; i < batch_size; ++i)
+			batch.emplace_back(randomness() % 5000, static_cast<int>(i));
+		for (const auto & update : batch)
+			one_at_a_time[update.first] += update.second;
+		random.merge_updates(batch.begin(), batch.end(), std::plus<int>());
+		ASSERT_EQ(one_at_a_time, random);
+	}
+}
+TEST(flat_multimap, insert)
+{
+	flat_multimap<int, int> foo = { { 5, 7 }, { 4, 3 }, { 5, 8 } };
+	ASSERT_EQ(3u, foo.size());
+	ASSERT_EQ(2u, foo.count(5));
+	// equal keys stay in the order in which they were inserted
+	foo.insert(std::make_pair(5, 9));
+	foo.emplace(4, 4);
+	foo.insert(foo.begin(), std::make_pair(5, 1));
+	std::vector<std::pair<int, int> > bar{ { 6, 1 }, { 5, 2 }, { 1, 1 }, { 5, 3 } };
+	foo.insert(bar.begin(), bar.end());
+	std::vector<std::pair<int, int> > expected{ { 1, 1 }, { 4, 3 }, { 4, 4 }, { 5, 7 }, { 5, 8 }, { 5, 9 }, { 5, 1 }, { 5, 2 }, { 5, 3 }, { 6, 1 } };
+	ASSERT_EQ(expected, (std::vector<std::pair<int, int> >(foo.begin(), foo.end())));
+	auto range = foo.equal_range(5);
+	ASSERT_EQ(foo.begin() + 3, range.first);
+	ASSERT_EQ(foo.begin() + 9, range.second);
+	ASSERT_EQ(foo.begin() + 3, foo.find(5));
+}
+TEST(flat_multimap, erase)
+{
+	flat_multimap<int, int> foo = { { 1, 2 }, { 3, 4 }, { 3, 5 }, { 5, 6 } };
+	ASSERT_EQ(2u, foo.erase(3));
+	ASSERT_EQ(0u, foo.erase(3));
+	ASSERT_EQ((flat_multimap<int, int>{ { 1, 2 }, { 5, 6 } }), foo);
+	std::vector<std::pair<int, int> > sorted{ { 5, 7 }, { 5, 8 }, { 6, 0 } };
+	foo.insert(sorted_equivalent, sorted.begin(), sorted.end());
+	ASSERT_EQ((flat_multimap<int, int>{ { 1, 2 }, { 5, 6 }, { 5, 7 }, { 5, 8 }, { 6, 0 } }), foo);
+}
+TEST(flat_multimap, erase_keys)
+{
+	flat_multimap<int, int> foo = { { 1, 1 }, { 2, 2 }, { 2, 3 }, { 3, 4 }, { 3, 5 }, { 4, 6 } };
+	std::vector<int> keys{ 2, 3 };
+	ASSERT_EQ(4u, foo.erase_keys(keys.begin(), keys.end()));
+	ASSERT_EQ((flat_multimap<int, int>{ { 1, 1 }, { 4, 6 } }), foo);
+}
+TEST(flat_multimap, not_default_constructible)
+{
+	struct Foo
+	{
+		explicit Foo(int i)
+			: i(i)
+		{
+		}
+		int i;
+	};
+	flat_multimap<int, Foo> foo;
+	foo.emplace(1, 5);
+	foo.emplace(1, 6);
+	foo.emplace_hint(foo.end(), 2, 7);
+	ASSERT_EQ(6, (foo.begin() + 1)->second.i);
+	ASSERT_EQ(7, (foo.begin() + 2)->second.i);
+}
+
 #ifdef RUN_SLOW_TESTS
 
 TEST(flat_map, insert_many_same)
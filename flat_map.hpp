@@ -30,49 +30,184 @@ For more information, please refer to <http://unlicense.org/>
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <memory>
+#include "flat_map_search.hpp"
 
 namespace detail
 {
 void throw_out_of_range(const char * message);
 }
 
-template<typename K, typename V, typename Comp = std::less<K>, typename Allocator = std::allocator<std::pair<K, V> > >
-struct flat_map
+// tags for constructors and insert functions that take input that is
+// already sorted. sorted_unique means that the input is sorted and has no
+// duplicate keys. sorted_equivalent means that it is sorted but may have
+// duplicate keys. if the input isn't actually sorted, the map will be broken
+struct sorted_unique_t
 {
-	typedef K key_type;
-	typedef V mapped_type;
-	typedef std::pair<K, V> value_type;
+};
+constexpr sorted_unique_t sorted_unique{};
+struct sorted_equivalent_t
+{
+};
+constexpr sorted_equivalent_t sorted_equivalent{};
+
+namespace detail
+{
+struct select_first
+{
+	template<typename Pair>
+	const typename Pair::first_type & operator()(const Pair & pair) const
+	{
+		return pair.first;
+	}
+};
+struct identity
+{
+	template<typename T>
+	const T & operator()(const T & value) const
+	{
+		return value;
+	}
+};
+
+template<typename T>
+struct void_type
+{
+	typedef void type;
+};
+// the last template argument of the flat containers can either be an
+// allocator, in which case the elements go into a std::vector with that
+// allocator, or it can be the container itself. anything with an iterator
+// typedef is treated as a container. a container has to behave like a
+// std::vector: random access iterators, emplace, emplace_back, pop_back,
+// erase, reserve and capacity
+template<typename T, typename AllocatorOrContainer, typename = void>
+struct container_for
+{
+	typedef std::vector<T, AllocatorOrContainer> type;
+};
+template<typename T, typename Container>
+struct container_for<T, Container, typename void_type<typename Container::iterator>::type>
+{
+	static_assert(std::is_same<typename Container::value_type, T>::value, "the container has to store the value_type of the map");
+	typedef Container type;
+};
+// whether the elements are in one array. the branchless search only works
+// on contiguous containers, everything else uses std::lower_bound
+template<typename Container>
+struct is_contiguous_container : std::false_type
+{
+};
+template<typename T, typename Allocator>
+struct is_contiguous_container<std::vector<T, Allocator> > : std::true_type
+{
+};
+// the hooks through which flat_tree reports what it does. they do nothing
+// unless the search policy is an instrumented_search from
+// flat_map_statistics.hpp, which specializes this. flat_tree derives from
+// it, so the empty version takes up no space and the calls compile away
+template<typename Search>
+struct instrumentation
+{
+protected:
+	template<typename Compare>
+	Compare counted(Compare comp) const
+	{
+		return comp;
+	}
+	void count_lookup(bool) const
+	{
+	}
+	void count_shift(size_t) const
+	{
+	}
+	void count_reallocation(size_t, size_t) const
+	{
+	}
+	void count_merge(size_t) const
+	{
+	}
+};
+
+// the implementation of flat_map, flat_multimap, flat_set and flat_multiset.
+// a sorted vector of Value, sorted by the key that KeyOfValue gets out of
+// each value. if Unique is false the vector can have several elements with
+// the same key, otherwise the first one that was inserted wins
+template<typename Key, typename Value, typename KeyOfValue, typename Comp, typename AllocatorOrContainer, typename Search, bool Unique>
+struct flat_tree : instrumentation<Search>
+{
+	typedef Key key_type;
+	typedef Value value_type;
 	typedef Comp key_compare;
+	typedef Search search_policy;
 	struct value_compare : std::binary_function<value_type, value_type, bool>
 	{
 		bool operator()(const value_type & lhs, const value_type & rhs) const
 		{
-			return key_compare()(lhs.first, rhs.first);
+			return key_compare()(KeyOfValue()(lhs), KeyOfValue()(rhs));
 		}
 	};
-	typedef Allocator allocator_type;
-	typedef V & reference;
-	typedef const V & const_reference;
+	typedef typename container_for<value_type, AllocatorOrContainer>::type container_type;
+	typedef typename container_type::allocator_type allocator_type;
+	typedef value_type & reference;
+	typedef const value_type & const_reference;
 	typedef typename std::allocator_traits<allocator_type>::pointer pointer;
 	typedef typename std::allocator_traits<allocator_type>::const_pointer const_pointer;
-	typedef std::vector<value_type, allocator_type> container_type;
 	typedef typename container_type::iterator iterator;
 	typedef typename container_type::const_iterator const_iterator;
 	typedef typename container_type::reverse_iterator reverse_iterator;
 	typedef typename container_type::const_reverse_iterator const_reverse_iterator;
 	typedef typename container_type::difference_type difference_type;
 	typedef typename container_type::size_type size_type;
+	// insert and emplace return whether they inserted something, unless
+	// there can be duplicates. then they always insert
+	typedef typename std::conditional<Unique, std::pair<iterator, bool>, iterator>::type insert_return_type;
 
-	flat_map() = default;
+	flat_tree() = default;
+	// for allocators with state, like the arena_allocator
+	explicit flat_tree(const allocator_type & allocator)
+		: data(allocator)
+	{
+	}
 	template<typename It>
-	flat_map(It begin, It end)
+	flat_tree(It begin, It end)
 	{
 		insert(begin, end);
 	}
-	flat_map(std::initializer_list<value_type> init)
-		: flat_map(init.begin(), init.end())
+	flat_tree(std::initializer_list<value_type> init)
+		: flat_tree(init.begin(), init.end())
 	{
 	}
+	// these don't sort. they only append the elements in O(n)
+	template<typename It>
+	flat_tree(sorted_unique_t, It begin, It end)
+	{
+		insert(sorted_unique, begin, end);
+	}
+	template<typename It>
+	flat_tree(sorted_equivalent_t, It begin, It end)
+	{
+		insert(sorted_equivalent, begin, end);
+	}
+	// takes ownership of the container without copying it. the first
+	// version sorts the elements and removes duplicates, the other two
+	// trust that they are already sorted
+	explicit flat_tree(container_type container)
+		: data(std::move(container))
+	{
+		auto comp = this->counted(value_compare());
+		std::stable_sort(data.begin(), data.end(), comp);
+		if (Unique) data.erase(std::unique(data.begin(), data.end(), std::not2(comp)), data.end());
+	}
+	flat_tree(sorted_unique_t, container_type container)
+		: data(std::move(container))
+	{
+	}
+	flat_tree(sorted_equivalent_t, container_type container)
+		: data(std::move(container))
+	{
+		if (Unique) data.erase(std::unique(data.begin(), data.end(), std::not2(this->counted(value_compare()))), data.end());
+	}
 
 	iterator				begin()				{	return data.begin();	}
 	iterator				end()				{	return data.end();		}
@@ -105,44 +240,22 @@ struct flat_map
 	}
 	void reserve(size_type size)
 	{
+		size_type capacity_before = data.capacity();
 		data.reserve(size);
+		this->count_reallocation(capacity_before, data.capacity());
 	}
 	void shrink_to_fit()
 	{
+		size_type capacity_before = data.capacity();
 		data.shrink_to_fit();
+		this->count_reallocation(capacity_before, data.capacity());
 	}
 
-	mapped_type & operator[](const key_type & key)
-	{
-		KeyOrValueCompare comp;
-		auto lower = lower_bound(key);
-		if (lower == end() || comp(key, *lower)) return data.emplace(lower, key, mapped_type())->second;
-		else return lower->second;
-	}
-	mapped_type & operator[](key_type && key)
-	{
-		KeyOrValueCompare comp;
-		auto lower = lower_bound(key);
-		if (lower == end() || comp(key, *lower)) return data.emplace(lower, std::move(key), mapped_type())->second;
-		else return lower->second;
-	}
-	mapped_type & at(const key_type & key)
-	{
-		auto found = binary_find(begin(), end(), key, KeyOrValueCompare());
-		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
-		return found->second;
-	}
-	const mapped_type & at(const key_type & key) const
-	{
-		auto found = binary_find(begin(), end(), key, KeyOrValueCompare());
-		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
-		return found->second;
-	}
-	std::pair<iterator, bool> insert(value_type && value)
+	insert_return_type insert(value_type && value)
 	{
 		return emplace(std::move(value));
 	}
-	std::pair<iterator, bool> insert(const value_type & value)
+	insert_return_type insert(const value_type & value)
 	{
 		return emplace(value);
 	}
@@ -158,64 +271,45 @@ struct flat_map
 	template<typename It>
 	void insert(It begin, It end)
 	{
-		// while I am at the capacity just use normal emplace
-		for (; begin != end && size() == capacity(); ++begin)
-		{
-			emplace(*begin);
-		}
-		if (begin == end) return;
-		// if I don't need to increase capacity I can use a more efficient
-		// insert method where I just put everything in the same vector
-		// and then merge in place. which gives me
-		// O(n + m log(m)) where n is the number of elements in the flat_map
-		// and m is std::distance(begin, end)
-		size_type size_before = data.size();
-		try
-		{
-			for (size_t i = capacity(); i > size_before && begin != end; --i, ++begin)
-			{
-				data.emplace_back(*begin);
-			}
-		}
-		catch(...)
-		{
-			// if emplace_back throws an exception, the easiest way to make sure
-			// that our invariants are still in place is to resize to the
-			// state we were in before
-			for (size_t i = data.size(); i > size_before; --i)
-			{
-				data.pop_back();
-			}
-			throw;
-		}
-		value_compare comp;
-		auto mid = data.begin() + size_before;
-		std::stable_sort(mid, data.end(), comp);
-		std::inplace_merge(data.begin(), mid, data.end(), comp);
-		data.erase(std::unique(data.begin(), data.end(), std::not2(comp)), data.end());
-		// make sure that we inserted at least one element before recursing. otherwise
-		// we'd recurse too often if we were to insert the same element many times
-		if (data.size() == size_before)
-		{
-			for (; begin != end; ++begin)
-			{
-				if (emplace(*begin).second)
-				{
-					++begin;
-					break;
-				}
-			}
-		}
-		// insert the remaining elements that didn't fit by calling this function recursively
-		// this will recurse log(n) times where n is std::distance(begin, end)
-		return insert(begin, end);
+		insert_range(begin, end, std::integral_constant<bool, Unique>(), 0);
 	}
 	void insert(std::initializer_list<value_type> il)
 	{
 		insert(il.begin(), il.end());
 	}
+	// for input that is already sorted: append it and merge it with the
+	// existing elements. O(n + m) instead of O(n + m log(m)). if all the
+	// new keys are bigger than the existing keys there is no merge at all
+	template<typename It>
+	void insert(sorted_unique_t, It begin, It end)
+	{
+		size_type size_before = data.size();
+		append(begin, end);
+		merge_appended(size_before, true);
+	}
+	template<typename It>
+	void insert(sorted_equivalent_t, It begin, It end)
+	{
+		size_type size_before = data.size();
+		append(begin, end);
+		merge_appended(size_before, false);
+	}
+	// moves the container out of the map, leaving the map empty
+	container_type extract() &&
+	{
+		container_type result = std::move(data);
+		data.clear();
+		return result;
+	}
+	// the opposite of extract. the new container has to be sorted, and
+	// has to be unique if this is not a multi container
+	void replace(container_type && container)
+	{
+		data = std::move(container);
+	}
 	iterator erase(iterator it)
 	{
+		this->count_shift(data.end() - it - 1);
 		return data.erase(it);
 	}
 	iterator erase(const_iterator it)
@@ -224,16 +318,77 @@ struct flat_map
 	}
 	size_type erase(const key_type & key)
 	{
-		auto found = find(key);
-		if (found == end()) return 0;
-		erase(found);
-		return 1;
+		if (Unique)
+		{
+			auto found = find(key);
+			if (found == end()) return 0;
+			erase(found);
+			return 1;
+		}
+		auto range = equal_range(key);
+		size_type result = range.second - range.first;
+		erase(range.first, range.second);
+		return result;
 	}
 	iterator erase(const_iterator first, const_iterator last)
 	{
+		this->count_shift(cend() - last);
 		return data.erase(iterator_const_cast(first), iterator_const_cast(last));
 	}
-	void swap(flat_map & other)
+	// the batch erases below go over the vector once and move every element
+	// that stays at most once, with move assignment. erasing k elements one
+	// at a time would shift the rest of the vector k times instead.
+	// they all return the number of erased elements
+
+	// erases every element for which pred returns true
+	template<typename Pred>
+	size_type erase_if(Pred pred)
+	{
+		auto new_end = std::remove_if(data.begin(), data.end(), pred);
+		size_type num_erased = data.end() - new_end;
+		data.erase(new_end, data.end());
+		return num_erased;
+	}
+	// the opposite of erase_if: keeps only the elements for which pred
+	// returns true
+	template<typename Pred>
+	size_type retain(Pred pred)
+	{
+		return erase_if([&pred](const value_type & value)
+		{
+			return !pred(value);
+		});
+	}
+	// erases the elements with the keys in [first, last). the keys have to
+	// be sorted by key_comp(), and can have duplicates or keys that are not
+	// in the map. O(n + m) where m is std::distance(first, last)
+	template<typename It>
+	size_type erase_keys(It first, It last)
+	{
+		if (first == last) return 0;
+		auto comp = this->counted(KeyOrValueCompare());
+		// nothing before the first key has to move
+		auto out = data.begin() + lower_bound_index(*first);
+		for (auto it = out; it != data.end(); ++it)
+		{
+			while (first != last && comp(*first, *it))
+				++first;
+			if (first == last)
+			{
+				out = out == it ? data.end() : std::move(it, data.end(), out);
+				break;
+			}
+			if (comp(*it, *first))
+			{
+				if (out != it) *out = std::move(*it);
+				++out;
+			}
+		}
+		size_type num_erased = data.end() - out;
+		data.erase(out, data.end());
+		return num_erased;
+	}
+	void swap(flat_tree & other)
 	{
 		data.swap(other.data);
 	}
@@ -241,29 +396,22 @@ struct flat_map
 	{
 		data.clear();
 	}
+	// if the first argument is a key or a value, it is used for the search
+	// and the new element is constructed in place. otherwise the element
+	// is constructed first so that there is a key to search with
 	template<typename First, typename... Args>
-	std::pair<iterator, bool> emplace(First && first, Args &&... args)
+	insert_return_type emplace(First && first, Args &&... args)
 	{
-		KeyOrValueCompare comp;
-		auto lower_bound = std::lower_bound(data.begin(), data.end(), first, comp);
-		if (lower_bound == data.end() || comp(first, *lower_bound)) return { data.emplace(lower_bound, std::forward<First>(first), std::forward<Args>(args)...), true };
-		else return { lower_bound, false };
+		return emplace_impl(is_key_or_value<First>(), std::forward<First>(first), std::forward<Args>(args)...);
 	}
-	std::pair<iterator, bool> emplace()
+	insert_return_type emplace()
 	{
 		return emplace(value_type());
 	}
 	template<typename First, typename... Args>
 	iterator emplace_hint(const_iterator hint, First && first, Args &&... args)
 	{
-		KeyOrValueCompare comp;
-		if (hint == cend() || comp(first, *hint))
-		{
-			if (hint == cbegin() || comp(*(hint - 1), first)) return data.emplace(iterator_const_cast(hint), std::forward<First>(first), std::forward<Args>(args)...);
-			else return emplace(std::forward<First>(first), std::forward<Args>(args)...).first;
-		}
-		else if (!comp(*hint, first)) return begin() + (hint - cbegin());
-		else return emplace(std::forward<First>(first), std::forward<Args>(args)...).first;
+		return emplace_hint_impl(is_key_or_value<First>(), hint, std::forward<First>(first), std::forward<Args>(args)...);
 	}
 	iterator emplace_hint(const_iterator hint)
 	{
@@ -282,139 +430,602 @@ struct flat_map
 	template<typename T>
 	iterator find(const T & key)
 	{
-		return binary_find(begin(), end(), key, KeyOrValueCompare());
+		return begin() + find_index(key);
 	}
 	template<typename T>
 	const_iterator find(const T & key) const
 	{
-		return binary_find(begin(), end(), key, KeyOrValueCompare());
+		return begin() + find_index(key);
 	}
 	template<typename T>
 	size_type count(const T & key) const
 	{
-		return std::binary_search(begin(), end(), key, KeyOrValueCompare()) ? 1 : 0;
+		if (Unique) return find_index(key) == size() ? 0 : 1;
+		auto range = equal_range(key);
+		return range.second - range.first;
 	}
 	template<typename T>
 	iterator lower_bound(const T & key)
 	{
-		return std::lower_bound(begin(), end(), key, KeyOrValueCompare());
+		return begin() + lower_bound_index(key);
 	}
 	template<typename T>
 	const_iterator lower_bound(const T & key) const
 	{
-		return std::lower_bound(begin(), end(), key, KeyOrValueCompare());
+		return begin() + lower_bound_index(key);
 	}
 	template<typename T>
 	iterator upper_bound(const T & key)
 	{
-		return std::upper_bound(begin(), end(), key, KeyOrValueCompare());
+		return begin() + upper_bound_index(key);
 	}
 	template<typename T>
 	const_iterator upper_bound(const T & key) const
 	{
-		return std::upper_bound(begin(), end(), key, KeyOrValueCompare());
+		return begin() + upper_bound_index(key);
 	}
 	template<typename T>
 	std::pair<iterator, iterator> equal_range(const T & key)
 	{
-		return std::equal_range(begin(), end(), key, KeyOrValueCompare());
+		size_type lower = lower_bound_index(key);
+		return { begin() + lower, begin() + upper_bound_index(key, lower) };
 	}
 	template<typename T>
 	std::pair<const_iterator, const_iterator> equal_range(const T & key) const
 	{
-		return std::equal_range(begin(), end(), key, KeyOrValueCompare());
+		size_type lower = lower_bound_index(key);
+		return { begin() + lower, begin() + upper_bound_index(key, lower) };
+	}
+	// looks up all the keys in [first, last) and writes one iterator per key
+	// to out, in the same order as the keys. several searches run at the
+	// same time so that their cache misses overlap. if the keys are sorted
+	// each search starts where the last one ended instead. It has to be
+	// a forward iterator because the keys are read more than once
+	template<typename It, typename Out>
+	Out lower_bound_many(It first, It last, Out out)
+	{
+		for_each_lower_bound(first, last, [&](const typename std::iterator_traits<It>::value_type &, size_type index)
+		{
+			*out++ = begin() + index;
+		});
+		return out;
+	}
+	template<typename It, typename Out>
+	Out lower_bound_many(It first, It last, Out out) const
+	{
+		for_each_lower_bound(first, last, [&](const typename std::iterator_traits<It>::value_type &, size_type index)
+		{
+			*out++ = begin() + index;
+		});
+		return out;
+	}
+	// like lower_bound_many, but writes end() for keys that are not in the map
+	template<typename It, typename Out>
+	Out find_many(It first, It last, Out out)
+	{
+		for_each_lower_bound(first, last, [&](const typename std::iterator_traits<It>::value_type & key, size_type index)
+		{
+			size_type found = found_or_size(key, index);
+			this->count_lookup(found != size());
+			*out++ = begin() + found;
+		});
+		return out;
+	}
+	template<typename It, typename Out>
+	Out find_many(It first, It last, Out out) const
+	{
+		for_each_lower_bound(first, last, [&](const typename std::iterator_traits<It>::value_type & key, size_type index)
+		{
+			size_type found = found_or_size(key, index);
+			this->count_lookup(found != size());
+			*out++ = begin() + found;
+		});
+		return out;
 	}
 	allocator_type get_allocator() const
 	{
 		return data.get_allocator();
 	}
 
-	bool operator==(const flat_map & other) const
+	bool operator==(const flat_tree & other) const
 	{
 		return data == other.data;
 	}
-	bool operator!=(const flat_map & other) const
+	bool operator!=(const flat_tree & other) const
 	{
 		return !(*this == other);
 	}
-	bool operator<(const flat_map & other) const
+	bool operator<(const flat_tree & other) const
 	{
 		return data < other.data;
 	}
-	bool operator>(const flat_map & other) const
+	bool operator>(const flat_tree & other) const
 	{
 		return other < *this;
 	}
-	bool operator<=(const flat_map & other) const
+	bool operator<=(const flat_tree & other) const
 	{
 		return !(other < *this);
 	}
-	bool operator>=(const flat_map & other) const
+	bool operator>=(const flat_tree & other) const
 	{
 		return !(*this < other);
 	}
 
-private:
+protected:
 	container_type data;
 
+	// every insert at a position goes through here
+	template<typename... Args>
+	iterator emplace_at(iterator position, Args &&... args)
+	{
+		size_type capacity_before = data.capacity();
+		this->count_shift(data.end() - position);
+		iterator result = data.emplace(position, std::forward<Args>(args)...);
+		this->count_reallocation(capacity_before, data.capacity());
+		return result;
+	}
+
+private:
 	iterator iterator_const_cast(const_iterator it)
 	{
 		return begin() + (it - cbegin());
 	}
 
-	struct KeyOrValueCompare
+	template<typename It>
+	void insert_range(It begin, It end, std::true_type, size_type depth)
 	{
-		bool operator()(const key_type & lhs, const key_type & rhs) const
+		// while I am at the capacity just use normal emplace
+		for (; begin != end && size() == capacity(); ++begin)
 		{
-			return key_compare()(lhs, rhs);
+			emplace(*begin);
 		}
-		bool operator()(const key_type & lhs, const value_type & rhs) const
+		if (begin == end) return;
+		// if I don't need to increase capacity I can use a more efficient
+		// insert method where I just put everything in the same vector
+		// and then merge in place. which gives me
+		// O(n + m log(m)) where n is the number of elements in the flat_map
+		// and m is std::distance(begin, end)
+		size_type size_before = data.size();
+		try
 		{
-			return key_compare()(lhs, rhs.first);
+			for (size_t i = capacity(); i > size_before && begin != end; --i, ++begin)
+			{
+				data.emplace_back(*begin);
+			}
 		}
-		template<typename T>
-		bool operator()(const key_type & lhs, const T & rhs) const
+		catch(...)
 		{
-			return key_compare()(lhs, rhs);
+			// if emplace_back throws an exception, the easiest way to make sure
+			// that our invariants are still in place is to resize to the
+			// state we were in before
+			for (size_t i = data.size(); i > size_before; --i)
+			{
+				data.pop_back();
+			}
+			throw;
 		}
-		template<typename T>
-		bool operator()(const T & lhs, const key_type & rhs) const
+		this->count_merge(depth);
+		auto comp = this->counted(value_compare());
+		auto mid = data.begin() + size_before;
+		std::stable_sort(mid, data.end(), comp);
+		std::inplace_merge(data.begin(), mid, data.end(), comp);
+		data.erase(std::unique(data.begin(), data.end(), std::not2(comp)), data.end());
+		// make sure that we inserted at least one element before recursing. otherwise
+		// we'd recurse too often if we were to insert the same element many times
+		if (data.size() == size_before)
+		{
+			for (; begin != end; ++begin)
+			{
+				if (emplace(*begin).second)
+				{
+					++begin;
+					break;
+				}
+			}
+		}
+		// insert the remaining elements that didn't fit by calling this function recursively
+		// this will recurse log(n) times where n is std::distance(begin, end)
+		return insert_range(begin, end, std::true_type(), depth + 1);
+	}
+	// with duplicates there is no need to be careful: append everything,
+	// sort the new elements and merge. stable, so that elements with the
+	// same key stay in the order in which they were inserted
+	template<typename It>
+	void insert_range(It begin, It end, std::false_type, size_type)
+	{
+		size_type size_before = data.size();
+		append(begin, end);
+		this->count_merge(0);
+		auto comp = this->counted(value_compare());
+		auto mid = data.begin() + size_before;
+		std::stable_sort(mid, data.end(), comp);
+		std::inplace_merge(data.begin(), mid, data.end(), comp);
+	}
+
+	template<typename T>
+	struct is_key_or_value
+		: std::integral_constant<bool, std::is_same<typename std::decay<T>::type, key_type>::value
+									|| std::is_same<typename std::decay<T>::type, value_type>::value>
+	{
+	};
+	template<typename First, typename... Args>
+	insert_return_type emplace_impl(std::true_type, First && first, Args &&... args)
+	{
+		return emplace_key_or_value(std::integral_constant<bool, Unique>(), std::forward<First>(first), std::forward<Args>(args)...);
+	}
+	template<typename... Args>
+	insert_return_type emplace_impl(std::false_type, Args &&... args)
+	{
+		return emplace(value_type(std::forward<Args>(args)...));
+	}
+	template<typename First, typename... Args>
+	std::pair<iterator, bool> emplace_key_or_value(std::true_type, First && first, Args &&... args)
+	{
+		auto comp = this->counted(KeyOrValueCompare());
+		auto lower_bound = data.begin() + lower_bound_index(first);
+		if (lower_bound == data.end() || comp(first, *lower_bound)) return { emplace_at(lower_bound, std::forward<First>(first), std::forward<Args>(args)...), true };
+		else return { lower_bound, false };
+	}
+	// like std::multimap, insert after all the elements with the same key
+	template<typename First, typename... Args>
+	iterator emplace_key_or_value(std::false_type, First && first, Args &&... args)
+	{
+		auto upper_bound = data.begin() + upper_bound_index(key_of(first));
+		return emplace_at(upper_bound, std::forward<First>(first), std::forward<Args>(args)...);
+	}
+	static iterator inserted_iterator(const std::pair<iterator, bool> & inserted)
+	{
+		return inserted.first;
+	}
+	static iterator inserted_iterator(iterator inserted)
+	{
+		return inserted;
+	}
+	template<typename First, typename... Args>
+	iterator emplace_hint_impl(std::true_type, const_iterator hint, First && first, Args &&... args)
+	{
+		auto comp = this->counted(KeyOrValueCompare());
+		if (Unique && hint != cend() && !comp(first, *hint) && !comp(*hint, first)) return iterator_const_cast(hint);
+		// with duplicates the new element may be equal to its neighbors
+		bool fits = Unique
+				? (hint == cend() || comp(first, *hint)) && (hint == cbegin() || comp(*(hint - 1), first))
+				: (hint == cend() || !comp(*hint, first)) && (hint == cbegin() || !comp(first, *(hint - 1)));
+		if (fits) return emplace_at(iterator_const_cast(hint), std::forward<First>(first), std::forward<Args>(args)...);
+		else return inserted_iterator(emplace(std::forward<First>(first), std::forward<Args>(args)...));
+	}
+	template<typename... Args>
+	iterator emplace_hint_impl(std::false_type, const_iterator hint, Args &&... args)
+	{
+		return emplace_hint(hint, value_type(std::forward<Args>(args)...));
+	}
+
+	template<typename It>
+	void append(It begin, It end)
+	{
+		size_type capacity_before = data.capacity();
+		reserve_for(begin, end, typename std::iterator_traits<It>::iterator_category());
+		size_type size_before = data.size();
+		try
 		{
-			return key_compare()(lhs, rhs);
+			for (; begin != end; ++begin)
+				data.emplace_back(*begin);
 		}
-		bool operator()(const value_type & lhs, const key_type & rhs) const
+		catch(...)
 		{
-			return key_compare()(lhs.first, rhs);
+			// same as in insert(It, It): go back to the state from before
+			for (size_t i = data.size(); i > size_before; --i)
+			{
+				data.pop_back();
+			}
+			throw;
 		}
-		bool operator()(const value_type & lhs, const value_type & rhs) const
+		this->count_reallocation(capacity_before, data.capacity());
+	}
+	template<typename It>
+	void reserve_for(It begin, It end, std::forward_iterator_tag)
+	{
+		data.reserve(data.size() + std::distance(begin, end));
+	}
+	template<typename It>
+	void reserve_for(It, It, std::input_iterator_tag)
+	{
+	}
+	// merges the sorted elements starting at size_before with the
+	// elements before them, and removes duplicates. the first one wins
+	void merge_appended(size_type size_before, bool appended_are_unique)
+	{
+		auto comp = this->counted(value_compare());
+		auto mid = data.begin() + size_before;
+		if (!Unique)
+			std::inplace_merge(data.begin(), mid, data.end(), comp);
+		else if (mid == data.begin() || mid == data.end() || comp(*(mid - 1), *mid))
 		{
-			return key_compare()(lhs.first, rhs.first);
+			// all new elements go after the old ones, only need to look
+			// for duplicates among the new elements
+			if (!appended_are_unique)
+				data.erase(std::unique(mid, data.end(), std::not2(comp)), data.end());
 		}
-		template<typename T>
-		bool operator()(const value_type & lhs, const T & rhs) const
+		else
 		{
-			return key_compare()(lhs.first, rhs);
+			std::inplace_merge(data.begin(), mid, data.end(), comp);
+			data.erase(std::unique(data.begin(), data.end(), std::not2(comp)), data.end());
 		}
-		template<typename T>
-		bool operator()(const T & lhs, const value_type & rhs) const
+	}
+
+	// compares keys with values, in any combination. anything that is not
+	// a value_type is treated as a key
+	struct KeyOrValueCompare
+	{
+		template<typename L, typename R>
+		bool operator()(const L & lhs, const R & rhs) const
 		{
-			return key_compare()(lhs, rhs.first);
+			return key_compare()(key_of(lhs), key_of(rhs));
 		}
 	};
+	static const key_type & key_of(const value_type & value)
+	{
+		return KeyOfValue()(value);
+	}
+	template<typename T>
+	static const T & key_of(const T & key)
+	{
+		return key;
+	}
 
-	// like std::binary_search, but returns the iterator to the element
-	// if it was found, and returns end otherwise
-	template<typename It, typename T, typename Compare>
-	static It binary_find(It begin, It end, const T & value, const Compare & cmp)
+	// every lookup goes through lower_bound_index, which calls the search
+	// policy. the policy gets a pointer if the container is contiguous so
+	// that it can use the SIMD search from flat_map_search.hpp
+	template<typename T>
+	size_type lower_bound_index(const T & key) const
+	{
+		if (data.empty()) return 0;
+		return Search::lower_bound(search_begin(is_contiguous_container<container_type>()), data.size(), key_of(key), KeyOfValue(), this->counted(key_compare()));
+	}
+	const value_type * search_begin(std::true_type) const
+	{
+		return std::addressof(data.front());
+	}
+	const_iterator search_begin(std::false_type) const
+	{
+		return data.begin();
+	}
+	// if the keys are unique the upper bound is right after the lower bound
+	template<typename T>
+	size_type upper_bound_index(const T & key) const
+	{
+		return upper_bound_index(key, lower_bound_index(key));
+	}
+	template<typename T>
+	size_type upper_bound_index(const T & key, size_type lower) const
+	{
+		if (Unique && std::is_same<T, key_type>::value)
+			return lower + (found_or_size(key, lower) != data.size());
+		else
+			return std::upper_bound(data.begin() + lower, data.end(), key, this->counted(KeyOrValueCompare())) - data.begin();
+	}
+	// like std::binary_search, but returns the index of the element
+	// if it was found, and returns size() otherwise
+	template<typename T>
+	size_type find_index(const T & key) const
+	{
+		size_type found = found_or_size(key, lower_bound_index(key));
+		this->count_lookup(found != data.size());
+		return found;
+	}
+	template<typename T>
+	size_type found_or_size(const T & key, size_type lower) const
+	{
+		if (lower == data.size() || this->counted(KeyOrValueCompare())(key, data[lower])) return data.size();
+		else return lower;
+	}
+
+	// calls func(key, lower_bound_index(key)) for every key in [first, last)
+	template<typename It, typename Func>
+	void for_each_lower_bound(It first, It last, Func && func) const
+	{
+		if (std::is_sorted(first, last, this->counted(key_compare()))) merge_lower_bounds(first, last, func);
+		else interleaved_lower_bounds(first, last, func);
+	}
+	// for sorted keys: gallop forward from the previous result. that costs
+	// O(log(d)) where d is the distance to the previous result, so a batch
+	// of m keys costs O(m log(n / m)) in total and reads the array in order
+	template<typename It, typename Func>
+	void merge_lower_bounds(It first, It last, Func & func) const
+	{
+		auto comp = this->counted(KeyOrValueCompare());
+		size_type lower = 0;
+		for (; first != last; ++first)
+		{
+			size_type step = 1;
+			size_type upper = lower;
+			while (upper < data.size() && comp(data[upper], *first))
+			{
+				lower = upper + 1;
+				upper += step;
+				step *= 2;
+			}
+			upper = std::min(upper, data.size());
+			lower = std::lower_bound(data.begin() + lower, data.begin() + upper, *first, comp) - data.begin();
+			func(*first, lower);
+		}
+	}
+	// for unsorted keys: run a group of binary searches in lockstep. all
+	// searches over the same array take the same number of steps, so they
+	// can share the loop. after each step, prefetch the element that the
+	// search will look at next. by the time the loop comes back around to
+	// the same search that element should be in the cache
+	template<typename It, typename Func>
+	void interleaved_lower_bounds(It first, It last, Func & func) const
+	{
+		static constexpr size_type group_size = 16;
+		auto comp = this->counted(KeyOrValueCompare());
+		auto elements = data.begin();
+		while (first != last)
+		{
+			It group_begin = first;
+			size_type bases[group_size];
+			size_type num_searches = 0;
+			for (; num_searches < group_size && first != last; ++num_searches, ++first)
+				bases[num_searches] = 0;
+			size_type n = data.size();
+			while (n > 1)
+			{
+				size_type half = n / 2;
+				size_type next_half = (n - half) / 2;
+				It key = group_begin;
+				for (size_type i = 0; i < num_searches; ++i, ++key)
+				{
+					size_type & base = bases[i];
+					base = comp(elements[base + half], *key) ? base + half : base;
+					__builtin_prefetch(std::addressof(elements[base + next_half]));
+				}
+				n -= half;
+			}
+			It key = group_begin;
+			for (size_type i = 0; i < num_searches; ++i, ++key)
+			{
+				size_type lower = bases[i] + (n == 1 && comp(elements[bases[i]], *key));
+				func(*key, lower);
+			}
+		}
+	}
+};
+
+}
+
+// the fourth template argument is either an allocator for a std::vector or
+// the container to use, for example small_vector<std::pair<K, V>, 8>. the
+// last one is the search that lookups use, see the policies at the end of
+// flat_map_search.hpp
+template<typename K, typename V, typename Comp = std::less<K>, typename AllocatorOrContainer = std::allocator<std::pair<K, V> >, typename Search = adaptive_search>
+struct flat_map : detail::flat_tree<K, std::pair<K, V>, detail::select_first, Comp, AllocatorOrContainer, Search, true>
+{
+private:
+	typedef detail::flat_tree<K, std::pair<K, V>, detail::select_first, Comp, AllocatorOrContainer, Search, true> base;
+public:
+	typedef V mapped_type;
+	typedef V & reference;
+	typedef const V & const_reference;
+	typedef typename base::key_type key_type;
+	typedef typename base::key_compare key_compare;
+
+	using base::base;
+	flat_map() = default;
+
+	mapped_type & operator[](const key_type & key)
+	{
+		auto lower = this->lower_bound(key);
+		if (lower == this->end() || this->counted(key_compare())(key, lower->first)) return this->emplace_at(lower, key, mapped_type())->second;
+		else return lower->second;
+	}
+	mapped_type & operator[](key_type && key)
+	{
+		auto lower = this->lower_bound(key);
+		if (lower == this->end() || this->counted(key_compare())(key, lower->first)) return this->emplace_at(lower, std::move(key), mapped_type())->second;
+		else return lower->second;
+	}
+	mapped_type & at(const key_type & key)
 	{
-		auto lower_bound = std::lower_bound(begin, end, value, cmp);
-		if (lower_bound == end || cmp(value, *lower_bound)) return end;
-		else return lower_bound;
+		auto found = this->find(key);
+		if (found == this->end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	const mapped_type & at(const key_type & key) const
+	{
+		auto found = this->find(key);
+		if (found == this->end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+
+	// upsert for a batch: elements with new keys are inserted, and for keys
+	// that are already in the map the value becomes combine(existing,
+	// incoming). so merge_updates(first, last, std::plus<int>()) adds up
+	// counters. if a key is in the batch several times, its updates are
+	// combined in order. this version sorts a copy of the batch first
+	template<typename It, typename Combine>
+	void merge_updates(It first, It last, Combine combine)
+	{
+		std::vector<typename base::value_type> sorted(first, last);
+		std::stable_sort(sorted.begin(), sorted.end(), this->counted(typename base::value_compare()));
+		merge_updates(sorted_equivalent, std::make_move_iterator(sorted.begin()), std::make_move_iterator(sorted.end()), std::move(combine));
+	}
+	// same as above for a batch that is sorted by key_comp(). one pass over
+	// both, O(n + m) or O(m log(n / m)) if the batch is much smaller than
+	// the map. if combine throws, the values that were already combined
+	// keep their new values but none of the new keys get inserted
+	template<typename It, typename Combine>
+	void merge_updates(sorted_equivalent_t, It first, It last, Combine combine)
+	{
+		auto & data = this->data;
+		size_t size_before = data.size();
+		auto comp = this->counted(key_compare());
+		auto less_than_key = [&comp](const typename base::value_type & element, const key_type & key)
+		{
+			return comp(element.first, key);
+		};
+		size_t i = 0;
+		try
+		{
+			for (; first != last; ++first)
+			{
+				auto && update = *first;
+				// gallop, in case the updates are sparse
+				if (i < size_before && comp(data[i].first, update.first))
+				{
+					size_t step = 1;
+					while (i + step < size_before && comp(data[i + step].first, update.first))
+					{
+						i += step;
+						step *= 2;
+					}
+					i = std::lower_bound(data.begin() + (i + 1), data.begin() + std::min(i + step, size_before), update.first, less_than_key) - data.begin();
+				}
+				if (i < size_before && !comp(update.first, data[i].first))
+					data[i].second = combine(std::move(data[i].second), std::forward<decltype(update)>(update).second);
+				// the new keys are appended in sorted order, so a repeated
+				// new key can only be the last one
+				else if (data.size() > size_before && !comp(data.back().first, update.first))
+					data.back().second = combine(std::move(data.back().second), std::forward<decltype(update)>(update).second);
+				else
+					data.emplace_back(std::forward<decltype(update)>(update));
+			}
+		}
+		catch(...)
+		{
+			while (data.size() > size_before)
+				data.pop_back();
+			throw;
+		}
+		auto mid = data.begin() + size_before;
+		if (mid != data.begin() && mid != data.end() && comp(mid->first, (mid - 1)->first))
+			std::inplace_merge(data.begin(), mid, data.end(), this->counted(typename base::value_compare()));
 	}
 };
 
-template<typename K, typename V, typename C, typename A>
-void swap(flat_map<K, V, C, A> & lhs, flat_map<K, V, C, A> & rhs)
+// like flat_map, but can have several elements with the same key. the
+// elements with the same key are in the order in which they were inserted
+template<typename K, typename V, typename Comp = std::less<K>, typename AllocatorOrContainer = std::allocator<std::pair<K, V> >, typename Search = adaptive_search>
+struct flat_multimap : detail::flat_tree<K, std::pair<K, V>, detail::select_first, Comp, AllocatorOrContainer, Search, false>
+{
+private:
+	typedef detail::flat_tree<K, std::pair<K, V>, detail::select_first, Comp, AllocatorOrContainer, Search, false> base;
+public:
+	typedef V mapped_type;
+	typedef V & reference;
+	typedef const V & const_reference;
+
+	using base::base;
+	flat_multimap() = default;
+};
+
+template<typename K, typename V, typename C, typename A, typename S>
+void swap(flat_map<K, V, C, A, S> & lhs, flat_map<K, V, C, A, S> & rhs)
+{
+	lhs.swap(rhs);
+}
+template<typename K, typename V, typename C, typename A, typename S>
+void swap(flat_multimap<K, V, C, A, S> & lhs, flat_multimap<K, V, C, A, S> & rhs)
 {
 	lhs.swap(rhs);
 }
@@ -0,0 +1,122 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "flat_map_algorithm.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+namespace
+{
+flat_map<int, int> random_map(std::mt19937 & randomness, size_t size, int max_key, int value)
+{
+	flat_map<int, int> result;
+	std::uniform_int_distribution<int> distribution(0, max_key);
+	while (result.size() < size)
+		result.emplace(distribution(randomness), value);
+	return result;
+}
+
+// checks against the std algorithms on the keys and against the obvious
+// implementation with find for the values
+void check_set_algorithms(const flat_map<int, int> & lhs, const flat_map<int, int> & rhs)
+{
+	flat_map<int, int> expected_union = lhs;
+	expected_union.insert(rhs.begin(), rhs.end());
+	ASSERT_EQ(expected_union, map_union(lhs, rhs));
+	flat_map<int, int> expected_intersection;
+	flat_map<int, int> expected_difference;
+	for (const auto & element : lhs)
+	{
+		if (rhs.find(element.first) == rhs.end())
+			expected_difference.insert(element);
+		else
+			expected_intersection.insert(element);
+	}
+	ASSERT_EQ(expected_intersection, map_intersection(lhs, rhs));
+	ASSERT_EQ(expected_difference, map_difference(lhs, rhs));
+	size_t num_matches = 0;
+	for (auto match : merge_join(lhs, rhs))
+	{
+		ASSERT_EQ(match.first->first, match.second->first);
+		ASSERT_EQ(lhs.find(match.first->first), match.first);
+		++num_matches;
+	}
+	ASSERT_EQ(expected_intersection.size(), num_matches);
+}
+}
+
+TEST(flat_map_algorithm, set_algorithms)
+{
+	flat_map<int, int> a = { { 1, 1 }, { 3, 1 }, { 5, 1 }, { 7, 1 } };
+	flat_map<int, int> b = { { 2, 2 }, { 3, 2 }, { 7, 2 }, { 8, 2 } };
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 2, 2 }, { 3, 1 }, { 5, 1 }, { 7, 1 }, { 8, 2 } }), map_union(a, b));
+	ASSERT_EQ((flat_map<int, int>{ { 3, 1 }, { 7, 1 } }), map_intersection(a, b));
+	ASSERT_EQ((flat_map<int, int>{ { 1, 1 }, { 5, 1 } }), map_difference(a, b));
+	ASSERT_EQ((flat_map<int, int>{ { 2, 2 }, { 8, 2 } }), map_difference(b, a));
+	flat_map<int, int> empty;
+	ASSERT_EQ(a, map_union(a, empty));
+	ASSERT_EQ(a, map_union(empty, a));
+	ASSERT_TRUE(map_intersection(a, empty).empty());
+	ASSERT_EQ(a, map_difference(a, empty));
+	ASSERT_TRUE(merge_join(empty, a).begin() == merge_join(empty, a).end());
+}
+TEST(flat_map_algorithm, random)
+{
+	std::mt19937 randomness(5);
+	// similar sizes take the plain merge, the others gallop
+	for (size_t lhs_size : { 0, 1, 10, 100, 1000 })
+	{
+		for (size_t rhs_size : { 0, 1, 10, 100, 1000 })
+		{
+			for (int max_key : { 100, 10000 })
+			{
+				if (lhs_size > size_t(max_key) || rhs_size > size_t(max_key))
+					continue;
+				flat_map<int, int> lhs = random_map(randomness, lhs_size, max_key, 1);
+				flat_map<int, int> rhs = random_map(randomness, rhs_size, max_key, 2);
+				check_set_algorithms(lhs, rhs);
+				check_set_algorithms(rhs, lhs);
+			}
+		}
+	}
+}
+TEST(flat_map_algorithm, different_value_types)
+{
+	flat_map<std::string, int> counts = { { "a", 1 }, { "b", 2 }, { "c", 3 } };
+	flat_map<std::string, std::string> names = { { "b", "bar" }, { "c", "baz" }, { "d", "qux" } };
+	std::string joined;
+	for (auto match : merge_join(counts, names))
+		joined += match.second->second + std::to_string(match.first->second);
+	ASSERT_EQ("bar2baz3", joined);
+	ASSERT_EQ((flat_map<std::string, int>{ { "b", 2 }, { "c", 3 } }), map_intersection(counts, names));
+	ASSERT_EQ((flat_map<std::string, int>{ { "a", 1 } }), map_difference(counts, names));
+}
+
+#endif
@@ -0,0 +1,246 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <iterator>
+
+// set operations on the keys of two flat_maps, done with one merge over
+// both sorted vectors instead of one lookup per key. if one map is much
+// smaller than the other, the bigger one is not walked element by element:
+// the merge gallops ahead in it, which costs O(log(d)) where d is the
+// distance skipped. so the cost is O(n + m) for maps of similar size and
+// O(m log(n / m)) if m is much smaller than n
+
+namespace detail
+{
+// gallop when one side is at least this many times bigger than the other
+static constexpr size_t gallop_ratio = 8;
+
+inline bool should_gallop(size_t lhs_size, size_t rhs_size)
+{
+	return lhs_size / (rhs_size + 1) >= gallop_ratio || rhs_size / (lhs_size + 1) >= gallop_ratio;
+}
+
+// returns the first element in [first, last) whose key is not less than key
+template<typename It, typename K, typename Comp>
+It skip_less(It first, It last, const K & key, Comp comp, bool gallop)
+{
+	if (!gallop)
+	{
+		while (first != last && comp(first->first, key))
+			++first;
+		return first;
+	}
+	if (first == last || !comp(first->first, key)) return first;
+	// first[lower] is less than key. double the step until that's not true
+	typename std::iterator_traits<It>::difference_type lower = 0;
+	typename std::iterator_traits<It>::difference_type step = 1;
+	typename std::iterator_traits<It>::difference_type size = last - first;
+	while (step < size && comp(first[step].first, key))
+	{
+		lower = step;
+		step *= 2;
+	}
+	return std::lower_bound(first + lower + 1, first + std::min(step, size), key, [&](const typename std::iterator_traits<It>::value_type & element, const K & key)
+	{
+		return comp(element.first, key);
+	});
+}
+
+// the iterator of merge_join. see the comment there
+template<typename LhsIt, typename RhsIt, typename Comp>
+struct join_iterator
+{
+	typedef std::forward_iterator_tag iterator_category;
+	typedef std::pair<LhsIt, RhsIt> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const value_type * pointer;
+	typedef const value_type & reference;
+
+	join_iterator() = default;
+	join_iterator(LhsIt lhs, LhsIt lhs_end, RhsIt rhs, RhsIt rhs_end, bool gallop)
+		: current(lhs, rhs), lhs_end(lhs_end), rhs_end(rhs_end), gallop(gallop)
+	{
+		find_match();
+	}
+
+	reference operator*() const
+	{
+		return current;
+	}
+	pointer operator->() const
+	{
+		return &current;
+	}
+	join_iterator & operator++()
+	{
+		++current.first;
+		++current.second;
+		find_match();
+		return *this;
+	}
+	join_iterator operator++(int)
+	{
+		join_iterator copy(*this);
+		++*this;
+		return copy;
+	}
+	bool operator==(const join_iterator & other) const
+	{
+		return current.first == other.current.first;
+	}
+	bool operator!=(const join_iterator & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	value_type current;
+	LhsIt lhs_end;
+	RhsIt rhs_end;
+	bool gallop = false;
+
+	// moves both sides forward until their keys are the same. if one side
+	// runs out, both go to the end so that this compares equal to end()
+	void find_match()
+	{
+		Comp comp;
+		while (current.first != lhs_end && current.second != rhs_end)
+		{
+			if (comp(current.first->first, current.second->first))
+				current.first = skip_less(current.first, lhs_end, current.second->first, comp, gallop);
+			else if (comp(current.second->first, current.first->first))
+				current.second = skip_less(current.second, rhs_end, current.first->first, comp, gallop);
+			else
+				return;
+		}
+		current.first = lhs_end;
+		current.second = rhs_end;
+	}
+};
+
+template<typename It>
+struct iterator_range
+{
+	iterator_range(It begin, It end)
+		: first(begin), last(end)
+	{
+	}
+	It begin() const
+	{
+		return first;
+	}
+	It end() const
+	{
+		return last;
+	}
+
+private:
+	It first;
+	It last;
+};
+}
+
+// iterates over the keys that are in both maps. each element is a pair of
+// iterators, one into each map, pointing at elements with the same key:
+// for (auto match : merge_join(lhs, rhs))
+//     reconcile(match.first->second, match.second->second);
+// the maps can have different value types. they must not change while the
+// join is in use
+template<typename K, typename V, typename C, typename A, typename S, typename V2, typename A2, typename S2>
+detail::iterator_range<detail::join_iterator<typename flat_map<K, V, C, A, S>::const_iterator, typename flat_map<K, V2, C, A2, S2>::const_iterator, C> >
+merge_join(const flat_map<K, V, C, A, S> & lhs, const flat_map<K, V2, C, A2, S2> & rhs)
+{
+	typedef detail::join_iterator<typename flat_map<K, V, C, A, S>::const_iterator, typename flat_map<K, V2, C, A2, S2>::const_iterator, C> iterator;
+	bool gallop = detail::should_gallop(lhs.size(), rhs.size());
+	return { iterator(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), gallop), iterator(lhs.end(), lhs.end(), rhs.end(), rhs.end(), gallop) };
+}
+
+// all the elements of both maps. if a key is in both, the element from lhs
+// is used, the same as in lhs.insert(rhs.begin(), rhs.end())
+template<typename K, typename V, typename C, typename A, typename S>
+flat_map<K, V, C, A, S> map_union(const flat_map<K, V, C, A, S> & lhs, const flat_map<K, V, C, A, S> & rhs)
+{
+	typename flat_map<K, V, C, A, S>::container_type result(lhs.get_allocator());
+	result.reserve(lhs.size() + rhs.size());
+	bool gallop = detail::should_gallop(lhs.size(), rhs.size());
+	C comp;
+	auto lhs_it = lhs.begin();
+	auto rhs_it = rhs.begin();
+	while (lhs_it != lhs.end() && rhs_it != rhs.end())
+	{
+		if (comp(lhs_it->first, rhs_it->first))
+		{
+			auto next = detail::skip_less(lhs_it, lhs.end(), rhs_it->first, comp, gallop);
+			result.insert(result.end(), lhs_it, next);
+			lhs_it = next;
+		}
+		else if (comp(rhs_it->first, lhs_it->first))
+		{
+			auto next = detail::skip_less(rhs_it, rhs.end(), lhs_it->first, comp, gallop);
+			result.insert(result.end(), rhs_it, next);
+			rhs_it = next;
+		}
+		else
+		{
+			result.push_back(*lhs_it++);
+			++rhs_it;
+		}
+	}
+	result.insert(result.end(), lhs_it, lhs.end());
+	result.insert(result.end(), rhs_it, rhs.end());
+	return flat_map<K, V, C, A, S>(sorted_unique, std::move(result));
+}
+
+// the elements of lhs whose keys are also in rhs
+template<typename K, typename V, typename C, typename A, typename S, typename V2, typename A2, typename S2>
+flat_map<K, V, C, A, S> map_intersection(const flat_map<K, V, C, A, S> & lhs, const flat_map<K, V2, C, A2, S2> & rhs)
+{
+	typename flat_map<K, V, C, A, S>::container_type result(lhs.get_allocator());
+	result.reserve(std::min(lhs.size(), rhs.size()));
+	for (auto match : merge_join(lhs, rhs))
+		result.push_back(*match.first);
+	return flat_map<K, V, C, A, S>(sorted_unique, std::move(result));
+}
+
+// the elements of lhs whose keys are not in rhs
+template<typename K, typename V, typename C, typename A, typename S, typename V2, typename A2, typename S2>
+flat_map<K, V, C, A, S> map_difference(const flat_map<K, V, C, A, S> & lhs, const flat_map<K, V2, C, A2, S2> & rhs)
+{
+	typename flat_map<K, V, C, A, S>::container_type result(lhs.get_allocator());
+	result.reserve(lhs.size());
+	auto lhs_it = lhs.begin();
+	for (auto match : merge_join(lhs, rhs))
+	{
+		result.insert(result.end(), lhs_it, match.first);
+		lhs_it = std::next(match.first);
+	}
+	result.insert(result.end(), lhs_it, lhs.end());
+	return flat_map<K, V, C, A, S>(sorted_unique, std::move(result));
+}
@@ -0,0 +1,840 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+// runtime benchmarks for flat_map. this is a separate executable from the
+// compile time tests, see flat_map_benchmark.pro. build it with optimizations
+// and with -march=native if you want to see the SIMD search
+
+#include "arena_allocator.hpp"
+#include "buffered_flat_map.hpp"
+#include "compact_flat_map.hpp"
+#include "flat_map.hpp"
+#include "flat_map_algorithm.hpp"
+#include "flat_map_parallel.hpp"
+#include "frozen_flat_map.hpp"
+#include "hashed_flat_map.hpp"
+#include "learned_flat_map.hpp"
+#include "mapped_flat_map.hpp"
+#include "sharded_flat_map.hpp"
+#include "small_vector.hpp"
+#include "snapshot_flat_map.hpp"
+#include "soa_flat_map.hpp"
+#include "tiered_vector.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+template<typename Func>
+double nanoseconds_per_lookup(size_t num_lookups, Func && func)
+{
+	auto before = std::chrono::high_resolution_clock::now();
+	func();
+	auto after = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(after - before).count() / num_lookups;
+}
+
+// to keep the compiler from optimizing the lookups away
+volatile size_t sink;
+
+template<typename K>
+void benchmark_search(const char * key_name, size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<K, K> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		K key = static_cast<K>(randomness() % (size * 4));
+		pairs.emplace_back(key, key);
+	}
+	flat_map<K, K> map(pairs.begin(), pairs.end());
+	const size_t num_lookups = 1000000;
+	std::vector<K> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(static_cast<K>(randomness() % (size * 4)));
+
+	double std_lower_bound = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		// this is what every lookup in flat_map used to do
+		size_t found = 0;
+		for (const K & key : keys)
+			found += std::lower_bound(map.begin(), map.end(), std::make_pair(key, K()), map.value_comp()) - map.begin();
+		sink = found;
+	});
+	double flat_map_lower_bound = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (const K & key : keys)
+			found += map.lower_bound(key) - map.begin();
+		sink = found;
+	});
+	frozen_flat_map<K, K> frozen(map);
+	double frozen_lower_bound = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (const K & key : keys)
+			found += frozen.lower_bound(key) - frozen.begin();
+		sink = found;
+	});
+	std::printf("%-10s %10zu %20.2f %20.2f %20.2f\n", key_name, size, std_lower_bound, flat_map_lower_bound, frozen_lower_bound);
+}
+
+struct large_value
+{
+	char bytes[200];
+};
+
+// flat_map and soa_flat_map with values that are much bigger than the keys
+void benchmark_large_values(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::int32_t, large_value> > pairs(size);
+	for (auto & pair : pairs)
+		pair.first = static_cast<std::int32_t>(randomness() % (size * 4));
+	flat_map<std::int32_t, large_value> map(pairs.begin(), pairs.end());
+	soa_flat_map<std::int32_t, large_value> soa(pairs.begin(), pairs.end());
+	const size_t num_lookups = 1000000;
+	std::vector<std::int32_t> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(static_cast<std::int32_t>(randomness() % (size * 4)));
+	double flat_map_find = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (std::int32_t key : keys)
+			found += map.find(key) - map.begin();
+		sink = found;
+	});
+	double soa_find = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (std::int32_t key : keys)
+			found += soa.find(key) - soa.begin();
+		sink = found;
+	});
+	std::printf("%10zu %20.2f %20.2f\n", size, flat_map_find, soa_find);
+}
+
+// looking up a batch of keys one at a time against find_many
+void benchmark_batch_lookup(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::int32_t, std::int32_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int32_t>(randomness() % (size * 4)), 0);
+	flat_map<std::int32_t, std::int32_t> map(pairs.begin(), pairs.end());
+	const size_t num_lookups = 1000000;
+	std::vector<std::int32_t> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(static_cast<std::int32_t>(randomness() % (size * 4)));
+	std::vector<flat_map<std::int32_t, std::int32_t>::iterator> found(num_lookups);
+	double one_at_a_time = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		auto out = found.begin();
+		for (std::int32_t key : keys)
+			*out++ = map.find(key);
+	});
+	double find_many = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		map.find_many(keys.begin(), keys.end(), found.begin());
+	});
+	std::sort(keys.begin(), keys.end());
+	double find_many_sorted = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		map.find_many(keys.begin(), keys.end(), found.begin());
+	});
+	sink = found.back() - map.begin();
+	std::printf("%10zu %20.2f %20.2f %20.2f\n", size, one_at_a_time, find_many, find_many_sorted);
+}
+
+// find on random uint64 keys, half of them hits, with and without the hash
+// table on the side
+void benchmark_hashed_lookup(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::uint64_t, std::uint64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(randomness(), i);
+	flat_map<std::uint64_t, std::uint64_t> map(pairs.begin(), pairs.end());
+	hashed_flat_map<std::uint64_t, std::uint64_t> hashed(map);
+	hashed.build_index();
+	const size_t num_lookups = 1000000;
+	std::vector<std::uint64_t> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(i % 2 ? randomness() : pairs[randomness() % size].first);
+	double flat_map_find = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (std::uint64_t key : keys)
+			found += map.find(key) - map.begin();
+		sink = found;
+	});
+	double hashed_find = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (std::uint64_t key : keys)
+			found += hashed.find(key) - hashed.begin();
+		sink = found;
+	});
+	std::printf("%10zu %20.2f %20.2f %20.2f\n", size, flat_map_find, hashed_find, static_cast<double>(hashed.index_memory_usage()) / size);
+}
+
+// memory that a key allocates
+size_t heap_bytes(std::uint64_t)
+{
+	return 0;
+}
+size_t heap_bytes(const std::string & key)
+{
+	return key.capacity() > 15 ? key.capacity() + 1 : 0;
+}
+// find in a flat_map and in a compact_flat_map with the same keys, half of
+// them hits. also prints the bytes per key of both. for strings that counts
+// what the strings allocate
+template<typename K>
+void benchmark_compact(const char * key_name, const std::vector<K> & all_keys)
+{
+	std::mt19937_64 randomness(all_keys.size());
+	std::vector<std::pair<K, std::uint32_t> > pairs;
+	for (size_t i = 0; i < all_keys.size(); i += 2)
+		pairs.emplace_back(all_keys[i], static_cast<std::uint32_t>(i));
+	flat_map<K, std::uint32_t> map(pairs.begin(), pairs.end());
+	compact_flat_map<K, std::uint32_t> compact(map);
+	const size_t num_lookups = 1000000;
+	std::vector<K> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(all_keys[randomness() % all_keys.size()]);
+	double flat_map_find = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (const K & key : keys)
+			found += map.count(key);
+		sink = found;
+	});
+	double compact_find = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (const K & key : keys)
+			found += compact.count(key);
+		sink = found;
+	});
+	size_t flat_map_bytes = map.size() * sizeof(K);
+	for (const auto & element : map)
+		flat_map_bytes += heap_bytes(element.first);
+	std::printf("%-10s %10zu %20.2f %20.2f %20.2f %20.2f\n", key_name, map.size(), flat_map_find, compact_find,
+				static_cast<double>(flat_map_bytes) / map.size(), static_cast<double>(compact.key_memory_usage()) / map.size());
+}
+// ids that are a few apart, and URLs with a few hosts and paths
+std::vector<std::uint64_t> make_ids(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::uint64_t> result;
+	result.reserve(size);
+	std::uint64_t id = 1000000000000ull;
+	for (size_t i = 0; i < size; ++i)
+		result.push_back(id += 1 + randomness() % 16);
+	return result;
+}
+std::vector<std::string> make_urls(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	const char * words[] = { "news", "sports", "article", "video", "2016", "images", "user", "profile", "search", "static" };
+	std::vector<std::string> result;
+	result.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		std::string url = "https://www.example" + std::to_string(randomness() % 100) + ".com";
+		for (int j = 0; j < 3; ++j)
+			url += std::string("/") + words[randomness() % 10];
+		url += "/" + std::to_string(randomness() % 1000000);
+		result.push_back(std::move(url));
+	}
+	return result;
+}
+
+// building a map from input that is already sorted
+void benchmark_sorted_construction(size_t size)
+{
+	std::vector<std::pair<std::int32_t, std::int32_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int32_t>(i * 2), 0);
+	double unsorted_constructor = nanoseconds_per_lookup(size, [&]
+	{
+		flat_map<std::int32_t, std::int32_t> map(pairs.begin(), pairs.end());
+		sink = map.size();
+	});
+	double sorted_constructor = nanoseconds_per_lookup(size, [&]
+	{
+		flat_map<std::int32_t, std::int32_t> map(sorted_unique, pairs.begin(), pairs.end());
+		sink = map.size();
+	});
+	double adopt = nanoseconds_per_lookup(size, [&]
+	{
+		flat_map<std::int32_t, std::int32_t> map(sorted_unique, std::move(pairs));
+		sink = map.size();
+		pairs = std::move(map).extract();
+	});
+	std::printf("%10zu %20.2f %20.2f %20.2f\n", size, unsorted_constructor, sorted_constructor, adopt);
+}
+
+// inserting a big unsorted batch into a big map with more and more threads
+void benchmark_parallel_insert(size_t size, unsigned num_threads)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::int64_t, std::int64_t> > existing;
+	std::vector<std::pair<std::int64_t, std::int64_t> > batch;
+	existing.reserve(size);
+	batch.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+	{
+		existing.emplace_back(static_cast<std::int64_t>(randomness()), 0);
+		batch.emplace_back(static_cast<std::int64_t>(randomness()), 0);
+	}
+	flat_map<std::int64_t, std::int64_t> map(existing.begin(), existing.end());
+	double nanoseconds = nanoseconds_per_lookup(size, [&]
+	{
+		insert(map, parallel_policy(num_threads, 0), batch.begin(), batch.end());
+	});
+	sink = map.size();
+	std::printf("%10zu %10u %20.2f\n", size, num_threads, nanoseconds);
+}
+
+// one random insert followed by one random lookup, over and over
+template<typename Map>
+double interleaved_insert_and_find(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	Map map;
+	return nanoseconds_per_lookup(size, [&]
+	{
+		size_t found = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			map.emplace(static_cast<std::int64_t>(randomness()), 0);
+			found += map.count(static_cast<std::int64_t>(randomness()));
+		}
+		sink = found + map.size();
+	});
+}
+void benchmark_buffered_insert(size_t size)
+{
+	double flat = interleaved_insert_and_find<flat_map<std::int64_t, std::int64_t> >(size);
+	double buffered = interleaved_insert_and_find<buffered_flat_map<std::int64_t, std::int64_t> >(size);
+	std::printf("%10zu %20.2f %20.2f\n", size, flat, buffered);
+}
+
+// an order book: a big map where every update erases one random price
+// level and adds another. also measures lookups because the tiered_vector
+// can't use the SIMD search
+template<typename Map>
+std::pair<double, double> order_book_updates(size_t size)
+{
+	const size_t num_updates = 2000;
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::int64_t, std::int64_t> > levels(size);
+	for (auto & level : levels)
+		level.first = static_cast<std::int64_t>(randomness());
+	Map map(levels.begin(), levels.end());
+	double update = nanoseconds_per_lookup(num_updates, [&]
+	{
+		for (size_t i = 0; i < num_updates; ++i)
+		{
+			map.erase(map.begin() + static_cast<std::ptrdiff_t>(randomness() % map.size()));
+			map.emplace(static_cast<std::int64_t>(randomness()), 0);
+		}
+	});
+	double find = nanoseconds_per_lookup(size, [&]
+	{
+		size_t found = 0;
+		for (size_t i = 0; i < size; ++i)
+			found += map.count(levels[randomness() % size].first);
+		sink = found;
+	});
+	return { update, find };
+}
+void benchmark_order_book(size_t size)
+{
+	std::pair<double, double> flat = order_book_updates<flat_map<std::int64_t, std::int64_t> >(size);
+	std::pair<double, double> tiered = order_book_updates<flat_map<std::int64_t, std::int64_t, std::less<std::int64_t>, tiered_vector<std::pair<std::int64_t, std::int64_t> > > >(size);
+	std::printf("%10zu %20.2f %20.2f %20.2f %20.2f\n", size, flat.first, tiered.first, flat.second, tiered.second);
+}
+
+// random uint64 keys, searched with the branchless binary search and with
+// the learned index. also prints how many bytes the index needs per key
+template<size_t Epsilon>
+void benchmark_learned_index(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::uint64_t, std::uint64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(randomness(), 0);
+	flat_map<std::uint64_t, std::uint64_t> map(std::move(pairs));
+	const size_t num_lookups = 1000000;
+	std::vector<std::uint64_t> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(map.begin()[randomness() % map.size()].first);
+	double binary = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (std::uint64_t key : keys)
+			found += map.lower_bound(key) - map.begin();
+		sink = found;
+	});
+	learned_flat_map<std::uint64_t, std::uint64_t, Epsilon> learned(std::move(map));
+	double learned_lookup = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		size_t found = 0;
+		for (std::uint64_t key : keys)
+			found += learned.lower_bound(key) - learned.begin();
+		sink = found;
+	});
+	std::printf("%10zu %10zu %20.2f %20.2f %20.3f\n", size, Epsilon, binary, learned_lookup, static_cast<double>(learned.memory_usage()) / size);
+}
+
+template<typename Search>
+double search_policy_lookup(const std::vector<std::pair<std::int64_t, std::int64_t> > & pairs, const std::vector<std::int64_t> & keys)
+{
+	flat_map<std::int64_t, std::int64_t, std::less<std::int64_t>, std::allocator<std::pair<std::int64_t, std::int64_t> >, Search> map(sorted_unique, pairs.begin(), pairs.end());
+	return nanoseconds_per_lookup(keys.size(), [&]
+	{
+		size_t found = 0;
+		for (std::int64_t key : keys)
+			found += map.lower_bound(key) - map.begin();
+		sink = found;
+	});
+}
+// timestamps that are roughly one second apart, searched with the
+// different search policies. the linear search is skipped for big maps
+void benchmark_search_policies(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::int64_t, std::int64_t> > pairs;
+	pairs.reserve(size);
+	std::int64_t timestamp = 1500000000000;
+	for (size_t i = 0; i < size; ++i)
+	{
+		timestamp += 900 + randomness() % 200;
+		pairs.emplace_back(timestamp, 0);
+	}
+	const size_t num_lookups = 1000000;
+	std::vector<std::int64_t> keys;
+	keys.reserve(num_lookups);
+	for (size_t i = 0; i < num_lookups; ++i)
+		keys.push_back(pairs.front().first + static_cast<std::int64_t>(randomness() % static_cast<std::uint64_t>(timestamp - pairs.front().first + 1)));
+	double std_lower_bound = search_policy_lookup<std_search>(pairs, keys);
+	double linear = size <= 1000 ? search_policy_lookup<linear_search>(pairs, keys) : 0.0;
+	double branchless = search_policy_lookup<branchless_search>(pairs, keys);
+	double interpolation = search_policy_lookup<interpolation_search>(pairs, keys);
+	double adaptive = search_policy_lookup<adaptive_search>(pairs, keys);
+	std::printf("%10zu %14.2f %14.2f %14.2f %14.2f %14.2f\n", size, std_lower_bound, linear, branchless, interpolation, adaptive);
+}
+
+// a TTL sweep: erase one in ten elements, picked at random, either with one
+// erase call per key, with erase_keys or with erase_if on the timestamps
+void benchmark_batch_erase(size_t size)
+{
+	std::mt19937_64 randomness(size);
+	std::vector<std::pair<std::int64_t, std::int64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int64_t>(i), static_cast<std::int64_t>(randomness() % 10));
+	const flat_map<std::int64_t, std::int64_t> map(sorted_unique, pairs.begin(), pairs.end());
+	std::vector<std::int64_t> expired;
+	for (const auto & pair : pairs)
+	{
+		if (pair.second == 0)
+			expired.push_back(pair.first);
+	}
+	flat_map<std::int64_t, std::int64_t> copy = map;
+	double one_at_a_time = nanoseconds_per_lookup(expired.size(), [&]
+	{
+		for (std::int64_t key : expired)
+			copy.erase(key);
+	});
+	copy = map;
+	double erase_keys = nanoseconds_per_lookup(expired.size(), [&]
+	{
+		copy.erase_keys(expired.begin(), expired.end());
+	});
+	copy = map;
+	double erase_if = nanoseconds_per_lookup(expired.size(), [&]
+	{
+		copy.erase_if([](const std::pair<std::int64_t, std::int64_t> & pair)
+		{
+			return pair.second == 0;
+		});
+	});
+	sink = copy.size();
+	std::printf("%10zu %20.2f %20.2f %20.2f\n", size, one_at_a_time, erase_keys, erase_if);
+}
+
+// a short lived map with a few elements, like one that is created for every
+// request. fills it and looks up every key once
+template<typename Map>
+void fill_small_map(Map & map, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+		map.emplace(static_cast<std::int32_t>((i * 7) % size), 0);
+	size_t found = 0;
+	for (size_t i = 0; i < size; ++i)
+		found += map.count(static_cast<std::int32_t>(i));
+	sink = found;
+}
+void benchmark_small_maps(size_t size)
+{
+	typedef std::pair<std::int32_t, std::int32_t> pair;
+	const size_t num_maps = 1000000;
+	double normal = nanoseconds_per_lookup(num_maps, [&]
+	{
+		for (size_t i = 0; i < num_maps; ++i)
+		{
+			flat_map<std::int32_t, std::int32_t> map;
+			fill_small_map(map, size);
+		}
+	});
+	double small = nanoseconds_per_lookup(num_maps, [&]
+	{
+		for (size_t i = 0; i < num_maps; ++i)
+		{
+			flat_map<std::int32_t, std::int32_t, std::less<std::int32_t>, small_vector<pair, 8> > map;
+			fill_small_map(map, size);
+		}
+	});
+	double arena = nanoseconds_per_lookup(num_maps, [&]
+	{
+		for (size_t i = 0; i < num_maps; ++i)
+		{
+			alignas(pair) char buffer[1024];
+			monotonic_arena arena(buffer, sizeof(buffer));
+			flat_map<std::int32_t, std::int32_t, std::less<std::int32_t>, arena_allocator<pair> > map{arena_allocator<pair>(arena)};
+			fill_small_map(map, size);
+		}
+	});
+	std::printf("%10zu %20.2f %20.2f %20.2f\n", size, normal, small, arena);
+}
+
+// startup cost of a saved map: reading the file into a flat_map against
+// mapping it. both do one lookup so that the mapped version touches a page
+void benchmark_load(size_t size)
+{
+	std::vector<std::pair<std::int64_t, std::int64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int64_t>(i * 2), 0);
+	flat_map<std::int64_t, std::int64_t> map(sorted_unique, std::move(pairs));
+	const char * path = "flat_map_benchmark_load.bin";
+	save_mapped_flat_map(map, path);
+	auto header = detail::make_mapped_flat_map_header<std::int64_t, std::int64_t>(size);
+	double read = nanoseconds_per_lookup(1000000, [&]
+	{
+		std::ifstream file(path, std::ios::binary);
+		file.seekg(header.data_offset);
+		std::vector<std::pair<std::int64_t, std::int64_t> > loaded(size);
+		file.read(reinterpret_cast<char *>(loaded.data()), size * sizeof(loaded[0]));
+		flat_map<std::int64_t, std::int64_t> map(sorted_unique, std::move(loaded));
+		sink = map.count(static_cast<std::int64_t>(size));
+	});
+	double mapped = nanoseconds_per_lookup(1000000, [&]
+	{
+		mapped_flat_map<std::int64_t, std::int64_t> map(path);
+		sink = map.count(static_cast<std::int64_t>(size));
+	});
+	std::remove(path);
+	std::printf("%10zu %20.3f %20.3f\n", size, read, mapped);
+}
+// reconciling two snapshots: for every key in the second map, look at the
+// element with the same key in the first map. either with one find per key or
+// with merge_join
+void benchmark_join(size_t size, size_t other_size)
+{
+	std::mt19937_64 randomness(size + other_size);
+	std::vector<std::pair<std::int64_t, std::int64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int64_t>(i * 2), 1);
+	const flat_map<std::int64_t, std::int64_t> map(sorted_unique, std::move(pairs));
+	std::vector<std::pair<std::int64_t, std::int64_t> > other_pairs;
+	for (size_t i = 0; i < other_size; ++i)
+		other_pairs.emplace_back(static_cast<std::int64_t>(randomness() % (size * 2)), 2);
+	const flat_map<std::int64_t, std::int64_t> other(other_pairs.begin(), other_pairs.end());
+	double find = nanoseconds_per_lookup(other.size(), [&]
+	{
+		std::int64_t sum = 0;
+		for (const auto & element : other)
+		{
+			auto found = map.find(element.first);
+			if (found != map.end())
+				sum += found->second + element.second;
+		}
+		sink = static_cast<size_t>(sum);
+	});
+	double join = nanoseconds_per_lookup(other.size(), [&]
+	{
+		std::int64_t sum = 0;
+		for (auto match : merge_join(map, other))
+			sum += match.first->second + match.second->second;
+		sink = static_cast<size_t>(sum);
+	});
+	double intersection = nanoseconds_per_lookup(other.size(), [&]
+	{
+		sink = map_intersection(map, other).size();
+	});
+	std::printf("%10zu %10zu %20.2f %20.2f %20.2f\n", size, other_size, find, join, intersection);
+}
+// a metrics rollup: add a batch of counter updates to the totals. one in ten
+// updates is for a key that is not in the map yet. either with operator[]
+// for every update or with merge_updates
+void benchmark_merge_updates(size_t size, size_t batch_size)
+{
+	std::mt19937_64 randomness(size + batch_size);
+	std::vector<std::pair<std::int64_t, std::int64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int64_t>(i * 2), 1);
+	const flat_map<std::int64_t, std::int64_t> map(sorted_unique, std::move(pairs));
+	std::vector<std::pair<std::int64_t, std::int64_t> > batch;
+	batch.reserve(batch_size);
+	for (size_t i = 0; i < batch_size; ++i)
+	{
+		std::int64_t key = static_cast<std::int64_t>(randomness() % size) * 2;
+		if (i % 10 == 0) ++key;
+		batch.emplace_back(key, 1);
+	}
+	flat_map<std::int64_t, std::int64_t> copy = map;
+	double one_at_a_time = nanoseconds_per_lookup(batch_size, [&]
+	{
+		for (const auto & update : batch)
+			copy[update.first] += update.second;
+	});
+	copy = map;
+	double merge_updates = nanoseconds_per_lookup(batch_size, [&]
+	{
+		copy.merge_updates(batch.begin(), batch.end(), std::plus<std::int64_t>());
+	});
+	sink = copy.size();
+	std::printf("%10zu %10zu %20.2f %20.2f\n", size, batch_size, one_at_a_time, merge_updates);
+}
+// readers on several threads, each one locking for every lookup: with a
+// shared lock around a flat_map, or with a snapshot of a snapshot_flat_map.
+// the time is for all the threads together, per lookup of one thread
+void benchmark_concurrent_reads(size_t size, unsigned num_threads)
+{
+	std::vector<std::pair<std::int64_t, std::int64_t> > pairs;
+	pairs.reserve(size);
+	for (size_t i = 0; i < size; ++i)
+		pairs.emplace_back(static_cast<std::int64_t>(i * 2), 1);
+	flat_map<std::int64_t, std::int64_t> map(sorted_unique, pairs.begin(), pairs.end());
+	const size_t num_lookups = 1000000;
+	std::shared_timed_mutex mutex;
+	double shared_lock = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937_64 randomness(thread);
+			size_t found = 0;
+			for (size_t i = 0; i < num_lookups; ++i)
+			{
+				std::shared_lock<std::shared_timed_mutex> lock(mutex);
+				found += map.count(static_cast<std::int64_t>(randomness() % (size * 2)));
+			}
+			sink = found;
+		});
+	});
+	snapshot_flat_map<std::int64_t, std::int64_t> snapshots(std::move(map));
+	double snapshot = nanoseconds_per_lookup(num_lookups, [&]
+	{
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937_64 randomness(thread);
+			auto reader = snapshots.make_reader();
+			size_t found = 0;
+			for (size_t i = 0; i < num_lookups; ++i)
+				found += reader.read()->count(static_cast<std::int64_t>(randomness() % (size * 2)));
+			sink = found;
+		});
+	});
+	std::printf("%10zu %10u %20.2f %20.2f\n", size, num_threads, shared_lock, snapshot);
+}
+// writers on several threads inserting random keys: into one flat_map behind
+// a mutex, or into a sharded_flat_map with 64 shards. ns per insert
+void benchmark_sharded_insert(size_t size, unsigned num_threads)
+{
+	size_t per_thread = size / num_threads;
+	flat_map<std::int64_t, std::int64_t> map;
+	std::mutex mutex;
+	double one_mutex = nanoseconds_per_lookup(per_thread * num_threads, [&]
+	{
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937_64 randomness(thread);
+			for (size_t i = 0; i < per_thread; ++i)
+			{
+				std::int64_t key = static_cast<std::int64_t>(randomness());
+				std::lock_guard<std::mutex> lock(mutex);
+				map.emplace(key, 0);
+			}
+		});
+	});
+	sharded_flat_map<std::int64_t, std::int64_t> sharded(64);
+	double sharded_insert = nanoseconds_per_lookup(per_thread * num_threads, [&]
+	{
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937_64 randomness(thread);
+			for (size_t i = 0; i < per_thread; ++i)
+				sharded.emplace(static_cast<std::int64_t>(randomness()), 0);
+		});
+	});
+	sink = map.size() + sharded.size();
+	std::printf("%10zu %10u %20.2f %20.2f\n", size, num_threads, one_mutex, sharded_insert);
+}
+// threads that each produce size / num_threads random pairs: inserting them
+// in batches of 1000 into one flat_map behind a mutex, or appending them to
+// a flat_map_builder and building at the end. ns per pair
+void benchmark_builder(size_t size, unsigned num_threads)
+{
+	size_t per_thread = size / num_threads;
+	flat_map<std::int64_t, std::int64_t> map;
+	std::mutex mutex;
+	double one_mutex = nanoseconds_per_lookup(per_thread * num_threads, [&]
+	{
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937_64 randomness(thread);
+			std::vector<std::pair<std::int64_t, std::int64_t> > batch;
+			for (size_t i = 0; i < per_thread; i += batch.size())
+			{
+				batch.clear();
+				for (size_t j = i; j < std::min(i + 1000, per_thread); ++j)
+					batch.emplace_back(static_cast<std::int64_t>(randomness()), 0);
+				std::lock_guard<std::mutex> lock(mutex);
+				map.insert(batch.begin(), batch.end());
+			}
+		});
+	});
+	flat_map_builder<std::int64_t, std::int64_t> builder(num_threads);
+	flat_map<std::int64_t, std::int64_t> built;
+	double build = nanoseconds_per_lookup(per_thread * num_threads, [&]
+	{
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937_64 randomness(thread);
+			for (size_t i = 0; i < per_thread; ++i)
+				builder.emplace(thread, static_cast<std::int64_t>(randomness()), 0);
+		});
+		built = builder.build(parallel_policy(num_threads));
+	});
+	sink = map.size() + built.size();
+	std::printf("%10zu %10u %20.2f %20.2f\n", size, num_threads, one_mutex, build);
+}
+}
+
+int main()
+{
+	std::printf("%-10s %10s %20s %20s %20s\n", "key", "size", "std::lower_bound ns", "flat_map ns", "frozen_flat_map ns");
+	for (size_t size : { 16, 1000, 10000, 100000, 1000000, 10000000 })
+	{
+		benchmark_search<std::int32_t>("int32", size);
+		benchmark_search<std::uint64_t>("uint64", size);
+		benchmark_search<double>("double", size);
+	}
+	std::printf("\nsearch policies on int64 timestamps, ns per lower_bound\n%10s %14s %14s %14s %14s %14s\n", "size", "std", "linear", "branchless", "interpolation", "adaptive");
+	for (size_t size : { 4, 8, 16, 64, 1000, 1000000, 10000000 })
+		benchmark_search_policies(size);
+	std::printf("\nlearned index on random uint64 keys\n%10s %10s %20s %20s %20s\n", "size", "epsilon", "flat_map ns", "learned ns", "index bytes per key");
+	for (size_t size : { 1000000, 10000000, 30000000 })
+	{
+		benchmark_learned_index<16>(size);
+		benchmark_learned_index<64>(size);
+	}
+	std::printf("\n200 byte values\n%10s %20s %20s\n", "size", "flat_map ns", "soa_flat_map ns");
+	for (size_t size : { 1000, 10000, 100000, 1000000 })
+		benchmark_large_values(size);
+	std::printf("\nbatch lookup\n%10s %20s %20s %20s\n", "size", "find ns", "find_many ns", "sorted find_many ns");
+	for (size_t size : { 1000, 100000, 1000000, 10000000 })
+		benchmark_batch_lookup(size);
+	std::printf("\nfind with a hash table on the side\n%10s %20s %20s %20s\n", "size", "flat_map ns", "hashed_flat_map ns", "index bytes per key");
+	for (size_t size : { 1000, 100000, 1000000, 10000000 })
+		benchmark_hashed_lookup(size);
+	std::printf("\ncompressed keys, half of the lookups hit\n%-10s %10s %20s %20s %20s %20s\n", "key", "size", "flat_map ns", "compact ns", "flat_map key bytes", "compact key bytes");
+	for (size_t size : { 1000, 1000000, 10000000 })
+		benchmark_compact("uint64", make_ids(size * 2));
+	for (size_t size : { 1000, 1000000 })
+		benchmark_compact("url", make_urls(size * 2));
+	std::printf("\nconstruction from sorted input, ns per element\n%10s %20s %20s %20s\n", "size", "flat_map(It, It)", "sorted_unique", "adopt container");
+	for (size_t size : { 1000, 100000, 1000000, 10000000 })
+		benchmark_sorted_construction(size);
+	std::printf("\nerasing 10%% of the elements, ns per erased element\n%10s %20s %20s %20s\n", "size", "erase one at a time", "erase_keys", "erase_if");
+	for (size_t size : { 1000, 10000, 100000 })
+		benchmark_batch_erase(size);
+	std::printf("\njoining two maps, ns per element of the second map\n%10s %10s %20s %20s %20s\n", "size", "other size", "find", "merge_join", "map_intersection");
+	for (size_t other_size : { 1000, 100000, 1000000 })
+		benchmark_join(1000000, other_size);
+	std::printf("\nadding a batch of counter updates, ns per update\n%10s %10s %20s %20s\n", "size", "batch size", "operator[]", "merge_updates");
+	for (size_t batch_size : { 1000, 10000, 100000 })
+		benchmark_merge_updates(100000, batch_size);
+	std::printf("\nshort lived small maps, ns per map\n%10s %20s %20s %20s\n", "size", "flat_map", "small_vector<8>", "arena");
+	for (size_t size : { 1, 4, 8, 16 })
+		benchmark_small_maps(size);
+	std::printf("\nopening a saved map, ms\n%10s %20s %20s\n", "size", "read into flat_map", "mapped_flat_map");
+	for (size_t size : { 1000, 1000000, 10000000 })
+		benchmark_load(size);
+	std::printf("\ninterleaved emplace and count, ns per pair\n%10s %20s %20s\n", "size", "flat_map ns", "buffered_flat_map ns");
+	for (size_t size : { 1000, 10000, 100000, 300000 })
+		benchmark_buffered_insert(size);
+	std::printf("\norder book, erase and emplace at random positions\n%10s %20s %20s %20s %20s\n", "size", "flat_map update ns", "tiered update ns", "flat_map find ns", "tiered find ns");
+	for (size_t size : { 10000, 100000, 1000000, 10000000 })
+		benchmark_order_book(size);
+	std::printf("\nconcurrent lookups, one lock or snapshot per lookup, ns per lookup\n%10s %10s %20s %20s\n", "size", "threads", "shared_timed_mutex", "snapshot_flat_map");
+	for (unsigned num_threads = 1; num_threads <= std::max(1u, std::thread::hardware_concurrency()); num_threads *= 2)
+		benchmark_concurrent_reads(100000, num_threads);
+	std::printf("\nconcurrent random inserts, ns per insert\n%10s %10s %20s %20s\n", "size", "threads", "one mutex", "sharded_flat_map");
+	for (unsigned num_threads = 1; num_threads <= std::max(1u, std::thread::hardware_concurrency()); num_threads *= 2)
+		benchmark_sharded_insert(100000, num_threads);
+	std::printf("\nbuilding a map from several threads, ns per element\n%10s %10s %20s %20s\n", "size", "threads", "mutex + insert", "flat_map_builder");
+	for (unsigned num_threads = 1; num_threads <= std::max(1u, std::thread::hardware_concurrency()); num_threads *= 2)
+		benchmark_builder(1000000, num_threads);
+	std::printf("\nparallel insert of a batch as big as the map, ns per element\n%10s %10s %20s\n", "size", "threads", "insert ns");
+	for (unsigned num_threads = 1; num_threads <= std::max(1u, std::thread::hardware_concurrency()); num_threads *= 2)
+		benchmark_parallel_insert(10000000, num_threads);
+}
@@ -0,0 +1,34 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += flat_map_benchmark.cpp \
+    arena_allocator.cpp \
+    flat_map.cpp \
+    mapped_flat_map.cpp
+
+HEADERS += \
+    arena_allocator.hpp \
+    buffered_flat_map.hpp \
+    compact_flat_map.hpp \
+    flat_map.hpp \
+    flat_map_algorithm.hpp \
+    flat_map_parallel.hpp \
+    flat_map_search.hpp \
+    frozen_flat_map.hpp \
+    hashed_flat_map.hpp \
+    learned_flat_map.hpp \
+    mapped_flat_map.hpp \
+    sharded_flat_map.hpp \
+    small_vector.hpp \
+    snapshot_flat_map.hpp \
+    soa_flat_map.hpp \
+    tiered_vector.hpp
+
+DEFINES += DISABLE_GTEST
+
+QMAKE_CXXFLAGS += -std=c++1y
+QMAKE_CXXFLAGS_RELEASE += -O3 -march=native
+
+LIBS += -lpthread
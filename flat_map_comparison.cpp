@@ -0,0 +1,413 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+// runtime comparison of flat_map against std::map, std::unordered_map and
+// boost::container::flat_map. this is its own executable, see
+// flat_map_comparison.pro. it prints CSV to stdout, one line per
+// measurement:
+// container,operation,key_bytes,value_bytes,size,result,unit
+// the unit is ns per operation, except for the memory row which is the
+// number of allocated bytes per element.
+//
+// options:
+// --filter=text    only run the measurements whose container or
+//                  operation name contains text, e.g. --filter=lookup
+// --max-size=n     skip the sizes bigger than n
+// --max-bytes=n    skip the sizes where the elements alone would take more
+//                  than n bytes. one gigabyte by default
+//
+// one at a time inserts and erases into the flat containers shift the
+// whole vector every time, so they get skipped for sizes where that would
+// move more than 10 gigabytes
+
+#include "flat_map.hpp"
+#include <boost/container/flat_map.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+// counts the bytes that the containers have allocated, for the memory row
+size_t allocated_bytes = 0;
+
+template<typename T>
+struct counting_allocator
+{
+	typedef T value_type;
+
+	counting_allocator() = default;
+	template<typename U>
+	counting_allocator(const counting_allocator<U> &)
+	{
+	}
+
+	T * allocate(size_t n)
+	{
+		allocated_bytes += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T * ptr, size_t n)
+	{
+		allocated_bytes -= n * sizeof(T);
+		std::allocator<T>().deallocate(ptr, n);
+	}
+
+	template<typename U>
+	bool operator==(const counting_allocator<U> &) const
+	{
+		return true;
+	}
+	template<typename U>
+	bool operator!=(const counting_allocator<U> &) const
+	{
+		return false;
+	}
+};
+
+// values of any size
+template<size_t Size>
+struct blob
+{
+	blob() = default;
+	explicit blob(std::uint64_t i)
+	{
+		std::memset(data, 0, Size);
+		data[0] = static_cast<char>(i);
+	}
+
+	char data[Size];
+};
+
+// a key that is compared with memcmp, like a fixed size string. all keys
+// have the same prefix, which makes the comparisons realistic
+template<size_t Size>
+struct fixed_key
+{
+	static_assert(Size >= 8, "need space for the number");
+
+	fixed_key() = default;
+	explicit fixed_key(std::uint64_t i)
+	{
+		std::memset(data, 'k', Size - 8);
+		for (size_t byte = 0; byte < 8; ++byte)
+			data[Size - 1 - byte] = static_cast<unsigned char>(i >> (byte * 8));
+	}
+	bool operator<(const fixed_key & other) const
+	{
+		return std::memcmp(data, other.data, Size) < 0;
+	}
+	bool operator==(const fixed_key & other) const
+	{
+		return std::memcmp(data, other.data, Size) == 0;
+	}
+
+	unsigned char data[Size];
+};
+
+struct key_hash
+{
+	size_t operator()(std::uint32_t key) const
+	{
+		return std::hash<std::uint32_t>()(key);
+	}
+	size_t operator()(std::uint64_t key) const
+	{
+		return std::hash<std::uint64_t>()(key);
+	}
+	// fnv-1a
+	template<size_t Size>
+	size_t operator()(const fixed_key<Size> & key) const
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (unsigned char byte : key.data)
+			hash = (hash ^ byte) * 1099511628211ull;
+		return static_cast<size_t>(hash);
+	}
+};
+
+template<typename K>
+K make_key(std::uint64_t i)
+{
+	return K(i);
+}
+
+template<typename K, typename V>
+using flat_map_for = flat_map<K, V, std::less<K>, counting_allocator<std::pair<K, V> > >;
+template<typename K, typename V>
+using boost_flat_map_for = boost::container::flat_map<K, V, std::less<K>, counting_allocator<std::pair<K, V> > >;
+template<typename K, typename V>
+using std_map_for = std::map<K, V, std::less<K>, counting_allocator<std::pair<const K, V> > >;
+template<typename K, typename V>
+using unordered_map_for = std::unordered_map<K, V, key_hash, std::equal_to<K>, counting_allocator<std::pair<const K, V> > >;
+
+// construction from sorted input, with the fastest way that each
+// container has for that
+template<typename Map, typename It>
+Map build_sorted(Map *, It first, It last)
+{
+	return Map(first, last);
+}
+template<typename K, typename V, typename It>
+flat_map_for<K, V> build_sorted(flat_map_for<K, V> *, It first, It last)
+{
+	return flat_map_for<K, V>(sorted_unique, first, last);
+}
+template<typename K, typename V, typename It>
+boost_flat_map_for<K, V> build_sorted(boost_flat_map_for<K, V> *, It first, It last)
+{
+	return boost_flat_map_for<K, V>(boost::container::ordered_unique_range, first, last);
+}
+
+// whether one at a time inserts and erases are affordable at this size
+template<typename Map>
+bool can_modify_one_at_a_time(Map *, double, size_t)
+{
+	return true;
+}
+inline bool shifts_are_affordable(double num_shifts, size_t size, size_t element_size)
+{
+	return num_shifts * size / 2 * element_size <= 10e9;
+}
+template<typename K, typename V>
+bool can_modify_one_at_a_time(flat_map_for<K, V> *, double num_shifts, size_t size)
+{
+	return shifts_are_affordable(num_shifts, size, sizeof(std::pair<K, V>));
+}
+template<typename K, typename V>
+bool can_modify_one_at_a_time(boost_flat_map_for<K, V> *, double num_shifts, size_t size)
+{
+	return shifts_are_affordable(num_shifts, size, sizeof(std::pair<K, V>));
+}
+
+struct options
+{
+	std::string filter;
+	size_t max_size = 10000000;
+	size_t max_bytes = size_t(1) << 30;
+
+	bool wanted(const char * container, const char * operation) const
+	{
+		return filter.empty() || std::strstr(container, filter.c_str()) || std::strstr(operation, filter.c_str());
+	}
+};
+
+// to keep the compiler from optimizing the work away
+volatile size_t sink;
+
+template<typename Func>
+double nanoseconds_per_operation(size_t num_operations, Func && func)
+{
+	auto before = std::chrono::high_resolution_clock::now();
+	func();
+	auto after = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(after - before).count() / num_operations;
+}
+
+// the test data for one size. the keys in the map are the odd numbers,
+// the misses are the even numbers
+template<typename K, typename V>
+struct inputs
+{
+	inputs(size_t size, size_t num_lookups)
+	{
+		std::mt19937_64 randomness(size);
+		sorted.reserve(size);
+		for (size_t i = 0; i < size; ++i)
+			sorted.emplace_back(make_key<K>(i * 2 + 1), V(i));
+		shuffled = sorted;
+		std::shuffle(shuffled.begin(), shuffled.end(), randomness);
+		hits.reserve(num_lookups);
+		misses.reserve(num_lookups);
+		for (size_t i = 0; i < num_lookups; ++i)
+		{
+			hits.push_back(sorted[randomness() % size].first);
+			misses.push_back(make_key<K>((randomness() % (size + 1)) * 2));
+		}
+		for (size_t i = 0; i < std::max(size_t(1), size / 10); ++i)
+			erased.push_back(shuffled[i].first);
+	}
+
+	std::vector<std::pair<K, V> > sorted;
+	std::vector<std::pair<K, V> > shuffled;
+	std::vector<K> hits;
+	std::vector<K> misses;
+	std::vector<K> erased;
+};
+
+void report(const char * container, const char * operation, size_t key_bytes, size_t value_bytes, size_t size, double result, const char * unit)
+{
+	std::printf("%s,%s,%zu,%zu,%zu,%.3f,%s\n", container, operation, key_bytes, value_bytes, size, result, unit);
+	std::fflush(stdout);
+}
+
+// small sizes are repeated on several maps so that every measurement does
+// roughly this many operations
+const size_t operations_per_measurement = 1000000;
+
+template<typename Map, typename K, typename V>
+void benchmark_container(const char * name, const options & opts, const inputs<K, V> & in)
+{
+	size_t size = in.sorted.size();
+	size_t repetitions = std::max(size_t(1), operations_per_measurement / size);
+	Map * tag = nullptr;
+	auto report_result = [&](const char * operation, double result, const char * unit)
+	{
+		report(name, operation, sizeof(K), sizeof(V), size, result, unit);
+	};
+
+	if (opts.wanted(name, "sorted_insert"))
+	{
+		std::vector<Map> maps;
+		maps.reserve(repetitions);
+		report_result("sorted_insert", nanoseconds_per_operation(size * repetitions, [&]
+		{
+			for (size_t i = 0; i < repetitions; ++i)
+				maps.push_back(build_sorted(tag, in.sorted.begin(), in.sorted.end()));
+		}), "ns");
+	}
+	if (opts.wanted(name, "random_insert") && can_modify_one_at_a_time(tag, static_cast<double>(size), size))
+	{
+		std::vector<Map> maps(repetitions);
+		report_result("random_insert", nanoseconds_per_operation(size * repetitions, [&]
+		{
+			for (Map & map : maps)
+			{
+				for (const auto & element : in.shuffled)
+					map.insert(element);
+			}
+		}), "ns");
+	}
+
+	size_t bytes_before = allocated_bytes;
+	Map map = build_sorted(tag, in.sorted.begin(), in.sorted.end());
+	if (opts.wanted(name, "memory"))
+		report_result("memory", static_cast<double>(allocated_bytes - bytes_before) / size, "bytes");
+	if (opts.wanted(name, "lookup_hit"))
+	{
+		report_result("lookup_hit", nanoseconds_per_operation(in.hits.size(), [&]
+		{
+			size_t found = 0;
+			for (const K & key : in.hits)
+				found += map.find(key) != map.end();
+			sink = found;
+		}), "ns");
+	}
+	if (opts.wanted(name, "lookup_miss"))
+	{
+		report_result("lookup_miss", nanoseconds_per_operation(in.misses.size(), [&]
+		{
+			size_t found = 0;
+			for (const K & key : in.misses)
+				found += map.find(key) != map.end();
+			sink = found;
+		}), "ns");
+	}
+	if (opts.wanted(name, "iterate"))
+	{
+		report_result("iterate", nanoseconds_per_operation(size * repetitions, [&]
+		{
+			size_t sum = 0;
+			for (size_t i = 0; i < repetitions; ++i)
+			{
+				for (const auto & element : map)
+					sum += static_cast<size_t>(element.second.data[0]);
+			}
+			sink = sum;
+		}), "ns");
+	}
+	if (opts.wanted(name, "erase") && can_modify_one_at_a_time(tag, static_cast<double>(in.erased.size()), size))
+	{
+		std::vector<Map> maps(repetitions, map);
+		report_result("erase", nanoseconds_per_operation(in.erased.size() * repetitions, [&]
+		{
+			for (Map & map : maps)
+			{
+				for (const K & key : in.erased)
+					map.erase(key);
+			}
+		}), "ns");
+	}
+}
+
+template<typename K, typename V>
+void benchmark_types(const options & opts)
+{
+	for (size_t size : { 8, 64, 1000, 10000, 100000, 1000000, 10000000 })
+	{
+		if (size > opts.max_size || size * sizeof(std::pair<K, V>) > opts.max_bytes)
+			continue;
+		inputs<K, V> in(size, operations_per_measurement);
+		benchmark_container<flat_map_for<K, V> >("flat_map", opts, in);
+		benchmark_container<boost_flat_map_for<K, V> >("boost_flat_map", opts, in);
+		benchmark_container<std_map_for<K, V> >("std_map", opts, in);
+		benchmark_container<unordered_map_for<K, V> >("std_unordered_map", opts, in);
+	}
+}
+
+bool parse_option(const char * argument, const char * name, std::string & value)
+{
+	size_t length = std::strlen(name);
+	if (std::strncmp(argument, name, length) != 0) return false;
+	value = argument + length;
+	return true;
+}
+}
+
+int main(int argc, char * argv[])
+{
+	options opts;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string value;
+		if (parse_option(argv[i], "--filter=", value))
+			opts.filter = value;
+		else if (parse_option(argv[i], "--max-size=", value))
+			opts.max_size = std::strtoull(value.c_str(), nullptr, 10);
+		else if (parse_option(argv[i], "--max-bytes=", value))
+			opts.max_bytes = std::strtoull(value.c_str(), nullptr, 10);
+		else
+		{
+			std::fprintf(stderr, "unknown argument %s\nusage: %s [--filter=text] [--max-size=n] [--max-bytes=n]\n", argv[i], argv[0]);
+			return 1;
+		}
+	}
+	std::printf("container,operation,key_bytes,value_bytes,size,result,unit\n");
+	benchmark_types<std::uint32_t, blob<4> >(opts);
+	benchmark_types<std::uint64_t, blob<8> >(opts);
+	benchmark_types<std::uint64_t, blob<56> >(opts);
+	benchmark_types<std::uint64_t, blob<248> >(opts);
+	benchmark_types<fixed_key<32>, blob<32> >(opts);
+}
@@ -0,0 +1,16 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += flat_map_comparison.cpp \
+    flat_map.cpp
+
+HEADERS += \
+    flat_map.hpp \
+    flat_map_search.hpp
+
+DEFINES += DISABLE_GTEST
+
+QMAKE_CXXFLAGS += -std=c++1y
+QMAKE_CXXFLAGS_RELEASE += -O3 -march=native
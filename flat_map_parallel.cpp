@@ -0,0 +1,136 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "flat_map_parallel.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+TEST(flat_map_parallel, same_as_insert)
+{
+	std::mt19937 randomness(5);
+	std::vector<std::pair<int, int> > existing;
+	for (int i = 0; i < 1000; ++i)
+		existing.emplace_back(static_cast<int>(randomness() % 5000), i);
+	std::vector<std::pair<int, int> > batch;
+	for (int i = 0; i < 10000; ++i)
+		batch.emplace_back(static_cast<int>(randomness() % 5000), -i);
+	for (unsigned num_threads : { 1, 2, 3, 4, 7, 8 })
+	{
+		flat_map<int, int> expected(existing.begin(), existing.end());
+		expected.insert(batch.begin(), batch.end());
+		flat_map<int, int> parallel(existing.begin(), existing.end());
+		insert(parallel, parallel_policy(num_threads, 0), batch.begin(), batch.end());
+		ASSERT_EQ(expected, parallel);
+	}
+}
+TEST(flat_map_parallel, small_batch)
+{
+	flat_map<std::string, int> map{ { "b", 1 } };
+	std::vector<std::pair<std::string, int> > batch{ { "c", 2 }, { "a", 3 }, { "b", 4 } };
+	insert(map, parallel_policy(4), batch.begin(), batch.end());
+	ASSERT_EQ((flat_map<std::string, int>{ { "a", 3 }, { "b", 1 }, { "c", 2 } }), map);
+	insert(map, parallel_policy(4, 0), batch.begin(), batch.begin());
+	ASSERT_EQ(3u, map.size());
+}
+TEST(flat_map_parallel, exception)
+{
+	struct ThrowingLess
+	{
+		bool operator()(int lhs, int rhs) const
+		{
+			if (lhs == 13 || rhs == 13) throw std::runtime_error("unlucky");
+			return lhs < rhs;
+		}
+	};
+	flat_map<int, int, ThrowingLess> map;
+	std::vector<std::pair<int, int> > batch;
+	for (int i = 0; i < 100; ++i)
+		batch.emplace_back(99 - i, i);
+	ASSERT_THROW(insert(map, parallel_policy(4, 0), batch.begin(), batch.end()), std::runtime_error);
+}
+
+TEST(flat_map_builder, same_as_insert)
+{
+	for (unsigned num_threads : { 1, 2, 3, 4, 7, 8 })
+	{
+		flat_map_builder<int, int> builder(num_threads);
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			std::mt19937 randomness(thread);
+			for (int i = 0; i < 3000; ++i)
+				builder.emplace(thread, static_cast<int>(randomness() % 5000), static_cast<int>(thread));
+		});
+		// insert the buffers in order so that the same elements win
+		flat_map<int, int> expected;
+		for (unsigned i = 0; i < num_threads; ++i)
+			expected.insert(builder.buffer(i).begin(), builder.buffer(i).end());
+		ASSERT_EQ(expected, builder.build(parallel_policy(num_threads, 0)));
+		ASSERT_EQ(0u, builder.size());
+	}
+}
+TEST(flat_map_builder, duplicates)
+{
+	flat_map_builder<std::string, int> builder(3);
+	builder.emplace(2, "a", 1);
+	builder.emplace(1, "a", 2);
+	builder.emplace(1, "b", 3);
+	builder.emplace(1, "b", 4);
+	builder.emplace(0, "c", 5);
+	ASSERT_EQ(5u, builder.size());
+	flat_map<std::string, int> map = builder.build(parallel_policy(4, 0));
+	ASSERT_EQ((flat_map<std::string, int>{ { "a", 2 }, { "b", 3 }, { "c", 5 } }), map);
+	ASSERT_EQ(3u, map.capacity());
+	ASSERT_TRUE(builder.build().empty());
+}
+TEST(flat_map_builder, not_default_constructible)
+{
+	struct no_default
+	{
+		explicit no_default(int value)
+			: value(value)
+		{
+		}
+		int value;
+	};
+	flat_map_builder<int, no_default> builder(4);
+	for (int i = 0; i < 100; ++i)
+		builder.emplace(i % 4, 99 - i, no_default(i));
+	flat_map<int, no_default> map = builder.build(parallel_policy(4, 0));
+	ASSERT_EQ(100u, map.size());
+	for (int i = 0; i < 100; ++i)
+		ASSERT_EQ(99 - i, map.at(i).value);
+	flat_map_builder<std::unique_ptr<int>, int> move_only(2);
+	move_only.emplace(1, std::unique_ptr<int>(), 1);
+	ASSERT_EQ(1u, move_only.build().size());
+}
+
+#endif
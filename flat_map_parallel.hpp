@@ -0,0 +1,456 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// a parallel version of flat_map::insert(It, It) for very big batches, and
+// flat_map_builder for building one map from several threads.
+// this is in its own header so that code that only uses flat_map doesn't
+// have to include <thread>
+
+// how many threads insert() should use, and how big a batch has to be
+// before it's worth starting threads at all
+struct parallel_policy
+{
+	explicit parallel_policy(unsigned num_threads = std::thread::hardware_concurrency(), size_t threshold = 65536)
+		: num_threads(num_threads ? num_threads : 1), threshold(threshold)
+	{
+	}
+
+	unsigned num_threads;
+	size_t threshold;
+};
+
+namespace detail
+{
+// runs func(0) to func(num_threads - 1) on num_threads threads, one of
+// them being the calling thread. if any of them throw, the first
+// exception gets rethrown after all of them have finished
+template<typename Func>
+void parallel_for(unsigned num_threads, Func && func)
+{
+	std::vector<std::exception_ptr> exceptions(num_threads);
+	auto run = [&](unsigned index)
+	{
+		try
+		{
+			func(index);
+		}
+		catch(...)
+		{
+			exceptions[index] = std::current_exception();
+		}
+	};
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads - 1);
+	for (unsigned i = 1; i < num_threads; ++i)
+		threads.emplace_back(run, i);
+	run(0);
+	for (std::thread & thread : threads)
+		thread.join();
+	for (std::exception_ptr & exception : exceptions)
+	{
+		if (exception) std::rethrow_exception(exception);
+	}
+}
+
+inline size_t chunk_begin(size_t size, unsigned num_chunks, unsigned chunk)
+{
+	return size * chunk / num_chunks;
+}
+
+// finds how many of the first diagonal elements of the merged output come
+// from the first range. ties go to the first range, like in std::merge
+template<typename It1, typename It2, typename Compare>
+size_t merge_path_split(It1 first1, size_t size1, It2 first2, size_t size2, size_t diagonal, const Compare & comp)
+{
+	size_t lower = diagonal > size2 ? diagonal - size2 : 0;
+	size_t upper = std::min(diagonal, size1);
+	while (lower < upper)
+	{
+		size_t mid = lower + (upper - lower) / 2;
+		if (!comp(first2[diagonal - mid - 1], first1[mid])) lower = mid + 1;
+		else upper = mid;
+	}
+	return lower;
+}
+
+// same result as std::merge, but every thread writes one equal sized part
+// of the output. the parts are found by binary searching along the merge path
+template<typename It1, typename It2, typename Out, typename Compare>
+void parallel_merge(It1 first1, It1 last1, It2 first2, It2 last2, Out out, const Compare & comp, unsigned num_threads)
+{
+	size_t size1 = last1 - first1;
+	size_t size2 = last2 - first2;
+	size_t total = size1 + size2;
+	parallel_for(num_threads, [&](unsigned thread)
+	{
+		size_t begin = chunk_begin(total, num_threads, thread);
+		size_t end = chunk_begin(total, num_threads, thread + 1);
+		size_t begin1 = merge_path_split(first1, size1, first2, size2, begin, comp);
+		size_t end1 = merge_path_split(first1, size1, first2, size2, end, comp);
+		std::merge(first1 + begin1, first1 + end1, first2 + (begin - begin1), first2 + (end - end1), out + begin, comp);
+	});
+}
+
+// stable sort: every thread sorts one chunk, then the chunks get merged
+// in log(num_threads) rounds of parallel_merge. buffer has to be as big as
+// values. the result can end up in either of the two, the return value
+// says which
+template<typename T, typename A, typename Compare>
+std::vector<T, A> & parallel_stable_sort(std::vector<T, A> & values, std::vector<T, A> & buffer, const Compare & comp, unsigned num_threads)
+{
+	size_t size = values.size();
+	parallel_for(num_threads, [&](unsigned thread)
+	{
+		std::stable_sort(values.begin() + chunk_begin(size, num_threads, thread), values.begin() + chunk_begin(size, num_threads, thread + 1), comp);
+	});
+	std::vector<T, A> * from = &values;
+	std::vector<T, A> * to = &buffer;
+	for (unsigned width = 1; width < num_threads; width *= 2)
+	{
+		for (unsigned chunk = 0; chunk < num_threads; chunk += 2 * width)
+		{
+			auto begin = std::make_move_iterator(from->begin() + chunk_begin(size, num_threads, chunk));
+			auto mid = std::make_move_iterator(from->begin() + chunk_begin(size, num_threads, std::min(chunk + width, num_threads)));
+			auto end = std::make_move_iterator(from->begin() + chunk_begin(size, num_threads, std::min(chunk + 2 * width, num_threads)));
+			parallel_merge(begin, mid, mid, end, to->begin() + (begin - std::make_move_iterator(from->begin())), comp, num_threads);
+		}
+		std::swap(from, to);
+	}
+	return *from;
+}
+
+// moves the first of every group of equivalent elements from values into
+// out, which has to be empty. two passes: first every thread counts what
+// it keeps in its chunk, then every thread moves its elements to where
+// the counts say they go
+template<typename T, typename A, typename Compare>
+void parallel_unique_move(std::vector<T, A> & values, std::vector<T, A> & out, const Compare & comp, unsigned num_threads)
+{
+	size_t size = values.size();
+	std::vector<unsigned char> keep(size);
+	std::vector<size_t> kept_before(num_threads + 1);
+	parallel_for(num_threads, [&](unsigned thread)
+	{
+		size_t count = 0;
+		for (size_t i = chunk_begin(size, num_threads, thread), end = chunk_begin(size, num_threads, thread + 1); i < end; ++i)
+		{
+			keep[i] = i == 0 || comp(values[i - 1], values[i]);
+			count += keep[i];
+		}
+		kept_before[thread + 1] = count;
+	});
+	for (unsigned i = 0; i < num_threads; ++i)
+		kept_before[i + 1] += kept_before[i];
+	out.resize(kept_before.back());
+	parallel_for(num_threads, [&](unsigned thread)
+	{
+		auto to = out.begin() + kept_before[thread];
+		for (size_t i = chunk_begin(size, num_threads, thread), end = chunk_begin(size, num_threads, thread + 1); i < end; ++i)
+		{
+			if (keep[i]) *to++ = std::move(values[i]);
+		}
+	});
+}
+
+// calls func(it) for every element in the sorted ranges [begin, end) in
+// sorted order, skipping elements that are equivalent to the one before.
+// of equivalent elements the one in the range with the lowest index wins
+template<typename It, typename Compare, typename Func>
+void kway_merge_unique(const std::vector<std::pair<It, It> > & ranges, const Compare & comp, Func && func)
+{
+	std::vector<size_t> heap;
+	std::vector<It> heads;
+	heads.reserve(ranges.size());
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		heads.push_back(ranges[i].first);
+		if (ranges[i].first != ranges[i].second) heap.push_back(i);
+	}
+	// std::make_heap puts the biggest element first, so this compares the
+	// other way around. ties go to the lower range index
+	auto heap_comp = [&](size_t lhs, size_t rhs)
+	{
+		if (comp(*heads[rhs], *heads[lhs])) return true;
+		else if (comp(*heads[lhs], *heads[rhs])) return false;
+		else return lhs > rhs;
+	};
+	std::make_heap(heap.begin(), heap.end(), heap_comp);
+	// func may move the element out, so it only gets called once all the
+	// duplicates of the element have been compared with it
+	It last;
+	bool has_last = false;
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), heap_comp);
+		size_t range = heap.back();
+		It it = heads[range]++;
+		if (!has_last || comp(*last, *it))
+		{
+			if (has_last) func(last);
+			last = it;
+			has_last = true;
+		}
+		if (heads[range] == ranges[range].second) heap.pop_back();
+		else std::push_heap(heap.begin(), heap.end(), heap_comp);
+	}
+	if (has_last) func(last);
+}
+
+template<typename K, typename V, typename C, typename A, typename S, typename It>
+void parallel_insert(flat_map<K, V, C, A, S> & map, const parallel_policy & policy, It begin, It end, std::true_type)
+{
+	typedef typename flat_map<K, V, C, A, S>::container_type container_type;
+	container_type batch(begin, end);
+	if (batch.size() < policy.threshold || policy.num_threads == 1)
+	{
+		map.insert(std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+		return;
+	}
+	unsigned num_threads = policy.num_threads;
+	auto comp = map.value_comp();
+	container_type buffer(batch.size());
+	container_type & sorted = parallel_stable_sort(batch, buffer, comp, num_threads);
+	container_type existing = std::move(map).extract();
+	container_type & merged = &sorted == &batch ? buffer : batch;
+	merged.resize(existing.size() + sorted.size());
+	// existing elements come first in the merge, so they win over new
+	// elements with the same key, just like in flat_map::insert
+	parallel_merge(std::make_move_iterator(existing.begin()), std::make_move_iterator(existing.end()),
+				   std::make_move_iterator(sorted.begin()), std::make_move_iterator(sorted.end()),
+				   merged.begin(), comp, num_threads);
+	existing.clear();
+	parallel_unique_move(merged, existing, comp, num_threads);
+	map.replace(std::move(existing));
+}
+// the parallel merges write into containers that were resized in advance,
+// which needs a default constructor. without one use the normal insert
+template<typename K, typename V, typename C, typename A, typename S, typename It>
+void parallel_insert(flat_map<K, V, C, A, S> & map, const parallel_policy &, It begin, It end, std::false_type)
+{
+	map.insert(begin, end);
+}
+}
+
+// inserts [begin, end) into the map, the same way that map.insert(begin, end)
+// would. if the batch is bigger than policy.threshold, the sort, the merge
+// with the existing elements and the removal of duplicates all run on
+// policy.num_threads threads. this needs O(n + m) extra memory. if an
+// exception is thrown in the parallel part, the map is left empty
+template<typename K, typename V, typename C, typename A, typename S, typename It>
+void insert(flat_map<K, V, C, A, S> & map, const parallel_policy & policy, It begin, It end)
+{
+	detail::parallel_insert(map, policy, begin, end, std::integral_constant<bool, std::is_default_constructible<K>::value && std::is_default_constructible<V>::value>());
+}
+
+// builds a flat_map from elements that come from several threads. every
+// thread appends to its own buffer, without locks, and build() sorts the
+// buffers in parallel and merges them into a single new container. if the
+// same key was added more than once, the element from the buffer with the
+// lowest index wins, and in the same buffer the one that was added first.
+//
+// the buffers are only thread local by convention: thread i should only
+// touch buffer i, and nobody should touch them during build(). the buffers
+// are spaced out so that appending to neighboring buffers doesn't cause
+// false sharing
+template<typename K, typename V, typename Comp = std::less<K>, typename AllocatorOrContainer = std::allocator<std::pair<K, V> >, typename Search = adaptive_search>
+struct flat_map_builder
+{
+	typedef flat_map<K, V, Comp, AllocatorOrContainer, Search> map_type;
+	typedef typename map_type::value_type value_type;
+	typedef typename map_type::container_type container_type;
+	typedef std::vector<value_type> buffer_type;
+
+	explicit flat_map_builder(unsigned num_buffers = std::thread::hardware_concurrency())
+		: buffers(num_buffers ? num_buffers : 1)
+	{
+	}
+
+	unsigned num_buffers() const
+	{
+		return static_cast<unsigned>(buffers.size());
+	}
+	buffer_type & buffer(unsigned index)
+	{
+		return buffers[index].elements;
+	}
+	template<typename... Args>
+	void emplace(unsigned index, Args &&... args)
+	{
+		buffers[index].elements.emplace_back(std::forward<Args>(args)...);
+	}
+	// the number of elements in all buffers, including duplicates
+	size_t size() const
+	{
+		size_t result = 0;
+		for (const padded_buffer & buffer : buffers)
+			result += buffer.elements.size();
+		return result;
+	}
+
+	// sorts every buffer on its own thread, then splits the key space into
+	// policy.num_threads parts of about the same size and does a k-way
+	// merge of all buffers for each part on its own thread. the merge runs
+	// twice: the first time only counts the unique elements, so that the
+	// result can be allocated once at exactly the right size, the second
+	// time moves the elements there. empties the buffers. if there are fewer
+	// than policy.threshold elements, everything runs on the calling thread,
+	// and without a default constructor the merge does. if the comparison
+	// throws, the buffers keep all their elements, minus duplicates
+	map_type build(const parallel_policy & policy = parallel_policy())
+	{
+		typedef std::integral_constant<bool, std::is_default_constructible<value_type>::value> can_assign;
+		unsigned num_threads = size() < policy.threshold ? 1 : policy.num_threads;
+		unsigned sort_threads = std::min(num_threads, num_buffers());
+		typename map_type::value_compare comp;
+		detail::parallel_for(sort_threads, [&](unsigned thread)
+		{
+			for (unsigned i = thread; i < num_buffers(); i += sort_threads)
+			{
+				buffer_type & elements = buffer(i);
+				std::stable_sort(elements.begin(), elements.end(), comp);
+				elements.erase(std::unique(elements.begin(), elements.end(), std::not2(comp)), elements.end());
+			}
+		});
+		std::vector<const value_type *> splits = choose_splits(can_assign::value ? num_threads : 1);
+		num_threads = static_cast<unsigned>(splits.size() + 1);
+		// the splits point into the buffers, so all ranges have to be found
+		// before the first element gets moved out
+		std::vector<std::vector<std::pair<buffer_iterator, buffer_iterator> > > ranges(num_threads);
+		std::vector<size_t> offsets(num_threads + 1);
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			ranges[thread] = ranges_for(splits, thread);
+			size_t count = 0;
+			detail::kway_merge_unique(ranges[thread], comp, [&count](buffer_iterator)
+			{
+				++count;
+			});
+			offsets[thread + 1] = count;
+		});
+		for (unsigned i = 0; i < num_threads; ++i)
+			offsets[i + 1] += offsets[i];
+		container_type result = make_result(offsets.back(), can_assign());
+		detail::parallel_for(num_threads, [&](unsigned thread)
+		{
+			append_or_assign(result, offsets[thread], ranges[thread], comp, can_assign());
+		});
+		for (padded_buffer & buffer : buffers)
+			buffer.elements.clear();
+		return map_type(sorted_unique, std::move(result));
+	}
+
+private:
+	typedef typename buffer_type::iterator buffer_iterator;
+	static constexpr size_t cache_line = 64;
+	struct padded_buffer
+	{
+		buffer_type elements;
+		char padding[cache_line];
+	};
+	std::vector<padded_buffer> buffers;
+
+	// takes a few evenly spaced elements from every buffer, and picks
+	// num_threads - 1 evenly spaced ones of those. returns fewer if there
+	// aren't enough different keys
+	std::vector<const value_type *> choose_splits(unsigned num_threads) const
+	{
+		std::vector<const value_type *> samples;
+		for (const padded_buffer & buffer : buffers)
+		{
+			const buffer_type & elements = buffer.elements;
+			for (unsigned i = 1; i < num_threads && !elements.empty(); ++i)
+				samples.push_back(std::addressof(elements[detail::chunk_begin(elements.size(), num_threads, i)]));
+		}
+		typename map_type::value_compare comp;
+		auto pointer_comp = [&comp](const value_type * lhs, const value_type * rhs)
+		{
+			return comp(*lhs, *rhs);
+		};
+		std::sort(samples.begin(), samples.end(), pointer_comp);
+		std::vector<const value_type *> splits;
+		for (unsigned i = 1; i < num_threads && !samples.empty(); ++i)
+		{
+			const value_type * split = samples[detail::chunk_begin(samples.size(), num_threads, i)];
+			if (splits.empty() || pointer_comp(splits.back(), split)) splits.push_back(split);
+		}
+		return splits;
+	}
+	// the part of every buffer that goes to the given thread. elements with
+	// the same key always end up in the same part
+	std::vector<std::pair<buffer_iterator, buffer_iterator> > ranges_for(const std::vector<const value_type *> & splits, unsigned thread)
+	{
+		typename map_type::value_compare comp;
+		std::vector<std::pair<buffer_iterator, buffer_iterator> > result;
+		result.reserve(buffers.size());
+		for (padded_buffer & buffer : buffers)
+		{
+			buffer_type & elements = buffer.elements;
+			auto begin = thread == 0 ? elements.begin() : std::lower_bound(elements.begin(), elements.end(), *splits[thread - 1], comp);
+			auto end = thread == splits.size() ? elements.end() : std::lower_bound(elements.begin(), elements.end(), *splits[thread], comp);
+			result.emplace_back(begin, end);
+		}
+		return result;
+	}
+	// with a default constructor every thread can assign to its own part of
+	// the result. without one a single thread has to append everything
+	static container_type make_result(size_t size, std::true_type)
+	{
+		return container_type(size);
+	}
+	static container_type make_result(size_t size, std::false_type)
+	{
+		container_type result;
+		result.reserve(size);
+		return result;
+	}
+	template<typename Ranges, typename Compare>
+	static void append_or_assign(container_type & result, size_t offset, const Ranges & ranges, const Compare & comp, std::true_type)
+	{
+		auto out = result.begin() + offset;
+		detail::kway_merge_unique(ranges, comp, [&out](buffer_iterator it)
+		{
+			*out++ = std::move(*it);
+		});
+	}
+	template<typename Ranges, typename Compare>
+	static void append_or_assign(container_type & result, size_t, const Ranges & ranges, const Compare & comp, std::false_type)
+	{
+		detail::kway_merge_unique(ranges, comp, [&result](buffer_iterator it)
+		{
+			result.emplace_back(std::move(*it));
+		});
+	}
+};
@@ -0,0 +1,489 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+// only pull in the intrinsics headers when the target can actually use them.
+// they are big and this header is included by flat_map.hpp
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+// the search policies at the bottom of this file use the SIMD and branchless
+// functions if this is true. it is true for built-in integer and floating
+// point keys compared with std::less. specialize this to std::false_type if
+// you want std::lower_bound
+template<typename K, typename Comp>
+struct use_branchless_search
+	: std::integral_constant<bool, std::is_arithmetic<K>::value
+									&& !std::is_same<K, bool>::value
+									&& std::is_same<Comp, std::less<K> >::value>
+{
+};
+
+namespace detail
+{
+// all the functions in here work on keys that are spaced stride bytes apart.
+// that way the same code works for the keys inside of a
+// std::vector<std::pair<K, V>> and for a plain array of keys
+
+template<typename K>
+inline const K & key_at(const char * first, size_t stride, size_t index)
+{
+	return *reinterpret_cast<const K *>(first + index * stride);
+}
+
+// counts how many of the n keys starting at first compare less than key.
+// the sum doesn't branch on the comparison, so the compiler is free to
+// vectorize it if it can
+template<typename K>
+size_t count_less_scalar(const char * first, size_t stride, size_t n, K key)
+{
+	size_t result = 0;
+	for (size_t i = 0; i < n; ++i)
+		result += key_at<K>(first, stride, i) < key;
+	return result;
+}
+
+enum class simd_key_kind
+{
+	none,
+	int32,
+	int64,
+	float32,
+	float64
+};
+template<typename K>
+struct simd_key_kind_of
+	: std::integral_constant<simd_key_kind,
+		std::is_same<K, float>::value ? simd_key_kind::float32
+		: std::is_same<K, double>::value ? simd_key_kind::float64
+		: !std::is_integral<K>::value || std::is_same<K, bool>::value ? simd_key_kind::none
+		: sizeof(K) == 4 ? simd_key_kind::int32
+		: sizeof(K) == 8 ? simd_key_kind::int64
+		: simd_key_kind::none>
+{
+};
+
+template<typename K, simd_key_kind Kind = simd_key_kind_of<K>::value>
+struct count_less_impl
+{
+	static size_t count(const char * first, size_t stride, size_t n, K key)
+	{
+		return count_less_scalar(first, stride, n, key);
+	}
+};
+
+#if defined(__AVX2__)
+// on AVX2 the scan loads eight (or four) keys at a time. if the keys are
+// not next to each other (because they are the first member of a pair)
+// they get collected with a gather instruction instead
+
+template<typename K>
+struct count_less_impl<K, simd_key_kind::int32>
+{
+	static size_t count(const char * first, size_t stride, size_t n, K key)
+	{
+		// there are only signed comparisons, so for unsigned keys flip the
+		// sign bit on both sides which gives the same ordering
+		const __m256i flip = _mm256_set1_epi32(std::is_signed<K>::value ? 0 : INT32_MIN);
+		const __m256i key8 = _mm256_xor_si256(_mm256_set1_epi32(static_cast<std::int32_t>(key)), flip);
+		const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(stride)));
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			const char * at = first + i * stride;
+			__m256i keys = stride == sizeof(K)
+					? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at))
+					: _mm256_i32gather_epi32(reinterpret_cast<const int *>(at), offsets, 1);
+			__m256i less = _mm256_cmpgt_epi32(key8, _mm256_xor_si256(keys, flip));
+			result += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+template<typename K>
+struct count_less_impl<K, simd_key_kind::int64>
+{
+	static size_t count(const char * first, size_t stride, size_t n, K key)
+	{
+		const __m256i flip = _mm256_set1_epi64x(std::is_signed<K>::value ? 0 : INT64_MIN);
+		const __m256i key4 = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(key)), flip);
+		const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(static_cast<int>(stride)));
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			const char * at = first + i * stride;
+			__m256i keys = stride == sizeof(K)
+					? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at))
+					: _mm256_i32gather_epi64(reinterpret_cast<const long long *>(at), offsets, 1);
+			__m256i less = _mm256_cmpgt_epi64(key4, _mm256_xor_si256(keys, flip));
+			result += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+template<>
+struct count_less_impl<float, simd_key_kind::float32>
+{
+	static size_t count(const char * first, size_t stride, size_t n, float key)
+	{
+		const __m256 key8 = _mm256_set1_ps(key);
+		const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(stride)));
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+		{
+			const char * at = first + i * stride;
+			__m256 keys = stride == sizeof(float)
+					? _mm256_loadu_ps(reinterpret_cast<const float *>(at))
+					: _mm256_i32gather_ps(reinterpret_cast<const float *>(at), offsets, 1);
+			result += __builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(keys, key8, _CMP_LT_OQ)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+template<>
+struct count_less_impl<double, simd_key_kind::float64>
+{
+	static size_t count(const char * first, size_t stride, size_t n, double key)
+	{
+		const __m256d key4 = _mm256_set1_pd(key);
+		const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(static_cast<int>(stride)));
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			const char * at = first + i * stride;
+			__m256d keys = stride == sizeof(double)
+					? _mm256_loadu_pd(reinterpret_cast<const double *>(at))
+					: _mm256_i32gather_pd(reinterpret_cast<const double *>(at), offsets, 1);
+			result += __builtin_popcount(_mm256_movemask_pd(_mm256_cmp_pd(keys, key4, _CMP_LT_OQ)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+
+#elif defined(__SSE4_2__)
+// SSE has no gather, so only keys that are next to each other get the
+// vector scan. keys inside of pairs use the scalar loop
+
+template<typename K>
+struct count_less_impl<K, simd_key_kind::int32>
+{
+	static size_t count(const char * first, size_t stride, size_t n, K key)
+	{
+		if (stride != sizeof(K)) return count_less_scalar(first, stride, n, key);
+		const __m128i flip = _mm_set1_epi32(std::is_signed<K>::value ? 0 : INT32_MIN);
+		const __m128i key4 = _mm_xor_si128(_mm_set1_epi32(static_cast<std::int32_t>(key)), flip);
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + i * stride));
+			__m128i less = _mm_cmpgt_epi32(key4, _mm_xor_si128(keys, flip));
+			result += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(less)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+template<typename K>
+struct count_less_impl<K, simd_key_kind::int64>
+{
+	static size_t count(const char * first, size_t stride, size_t n, K key)
+	{
+		if (stride != sizeof(K)) return count_less_scalar(first, stride, n, key);
+		const __m128i flip = _mm_set1_epi64x(std::is_signed<K>::value ? 0 : INT64_MIN);
+		const __m128i key2 = _mm_xor_si128(_mm_set1_epi64x(static_cast<long long>(key)), flip);
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + i * stride));
+			__m128i less = _mm_cmpgt_epi64(key2, _mm_xor_si128(keys, flip));
+			result += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(less)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+template<>
+struct count_less_impl<float, simd_key_kind::float32>
+{
+	static size_t count(const char * first, size_t stride, size_t n, float key)
+	{
+		if (stride != sizeof(float)) return count_less_scalar(first, stride, n, key);
+		const __m128 key4 = _mm_set1_ps(key);
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 keys = _mm_loadu_ps(reinterpret_cast<const float *>(first + i * stride));
+			result += __builtin_popcount(_mm_movemask_ps(_mm_cmplt_ps(keys, key4)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+template<>
+struct count_less_impl<double, simd_key_kind::float64>
+{
+	static size_t count(const char * first, size_t stride, size_t n, double key)
+	{
+		if (stride != sizeof(double)) return count_less_scalar(first, stride, n, key);
+		const __m128d key2 = _mm_set1_pd(key);
+		size_t result = 0;
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128d keys = _mm_loadu_pd(reinterpret_cast<const double *>(first + i * stride));
+			result += __builtin_popcount(_mm_movemask_pd(_mm_cmplt_pd(keys, key2)));
+		}
+		return result + count_less_scalar(first + i * stride, stride, n - i, key);
+	}
+};
+#endif
+
+// same result as std::lower_bound, but returns an index. the loop doesn't
+// branch on the comparison, so there is nothing to mispredict. it narrows
+// the range down to about one cache line and then scans that line
+template<typename K>
+size_t branchless_lower_bound(const char * first, size_t stride, size_t n, K key)
+{
+	const size_t window = stride < 64 ? 64 / stride : 1;
+	size_t begin = 0;
+	while (n > window)
+	{
+		size_t half = n / 2;
+		// without branches the CPU can't speculate ahead, so on big arrays
+		// fetch both places where the next comparison could be
+		__builtin_prefetch(first + (begin + (n - half) / 2) * stride);
+		__builtin_prefetch(first + (begin + half + (n - half) / 2) * stride);
+		begin = key_at<K>(first, stride, begin + half) < key ? begin + half : begin;
+		n -= half;
+	}
+	return begin + count_less_impl<K>::count(first + begin * stride, stride, n, key);
+}
+template<typename K>
+size_t branchless_lower_bound(const K * first, size_t n, K key)
+{
+	return branchless_lower_bound(reinterpret_cast<const char *>(first), sizeof(K), n, key);
+}
+
+// the search policies call the functions above if the keys are in one array
+// and are searched with a key of the same type. otherwise they fall back to
+// code that works on any random access iterator and comparison
+template<typename It, typename KeyOfValue>
+struct key_of_element
+{
+	typedef typename std::decay<decltype(std::declval<KeyOfValue>()(*std::declval<It>()))>::type type;
+};
+template<typename It, typename KeyOfValue, typename Comp, typename T>
+struct is_arithmetic_search
+	: std::integral_constant<bool, use_branchless_search<typename key_of_element<It, KeyOfValue>::type, Comp>::value
+									&& std::is_same<T, typename key_of_element<It, KeyOfValue>::type>::value>
+{
+};
+template<typename It, typename KeyOfValue, typename Comp, typename T>
+struct use_key_kernel
+	: std::integral_constant<bool, std::is_pointer<It>::value && is_arithmetic_search<It, KeyOfValue, Comp, T>::value>
+{
+};
+template<typename It, typename KeyOfValue>
+const char * key_bytes(It begin, KeyOfValue key_of)
+{
+	return reinterpret_cast<const char *>(std::addressof(key_of(*begin)));
+}
+
+template<typename It, typename KeyOfValue, typename Comp, typename T>
+size_t std_lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+{
+	return std::lower_bound(begin, begin + n, key, [&](const typename std::iterator_traits<It>::value_type & element, const T & key)
+	{
+		return comp(key_of(element), key);
+	}) - begin;
+}
+}
+
+// search policies for the last template argument of flat_map, flat_set etc.
+// a policy has one function, lower_bound, which gets an iterator to the
+// first of n elements. if the container is contiguous that iterator is a
+// plain pointer. the policies get the key out of an element with key_of
+// and compare keys with comp. they are never called with n == 0
+
+// what std::map would do
+struct std_search
+{
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+	{
+		return detail::std_lower_bound(begin, n, key, key_of, comp);
+	}
+};
+
+// looks at every element. for built-in keys this is a SIMD count that
+// doesn't stop early, for other keys it stops at the first element that
+// is not less than the key. only good for maps with a handful of elements
+struct linear_search
+{
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+	{
+		return lower_bound(begin, n, key, key_of, comp, detail::use_key_kernel<It, KeyOfValue, Comp, T>());
+	}
+
+private:
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp, std::true_type)
+	{
+		return detail::count_less_impl<T>::count(detail::key_bytes(begin, key_of), sizeof(*begin), n, key);
+	}
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp, std::false_type)
+	{
+		size_t i = 0;
+		while (i < n && comp(key_of(begin[i]), key))
+			++i;
+		return i;
+	}
+};
+
+// binary search without a branch on the comparison. for built-in keys this
+// is branchless_lower_bound from above, with prefetching and a SIMD scan at
+// the end. for other keys it is the same loop without those
+struct branchless_search
+{
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+	{
+		return lower_bound(begin, n, key, key_of, comp, detail::use_key_kernel<It, KeyOfValue, Comp, T>());
+	}
+
+private:
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp, std::true_type)
+	{
+		return detail::branchless_lower_bound(detail::key_bytes(begin, key_of), sizeof(*begin), n, key);
+	}
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp, std::false_type)
+	{
+		size_t base = 0;
+		while (n > 1)
+		{
+			size_t half = n / 2;
+			base = comp(key_of(begin[base + half]), key) ? base + half : base;
+			n -= half;
+		}
+		return base + comp(key_of(begin[base]), key);
+	}
+};
+
+// guesses where the key is from the first and the last key in the range,
+// assuming that the keys are evenly spread out. on keys like that it needs
+// O(log(log(n))) steps instead of O(log(n)). after every guess that doesn't
+// at least halve the range it does one normal binary search step, so it is
+// never worse than twice the steps of a binary search. only works for
+// built-in keys, for everything else this is std_search
+struct interpolation_search
+{
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+	{
+		return lower_bound(begin, n, key, key_of, comp, detail::is_arithmetic_search<It, KeyOfValue, Comp, T>());
+	}
+
+private:
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp, std::true_type)
+	{
+		// everything before lower is less than key, everything from upper on
+		// is not less than key
+		size_t lower = 0;
+		size_t upper = n;
+		bool guess = true;
+		while (upper - lower > 16)
+		{
+			size_t probe;
+			if (guess)
+			{
+				T first = key_of(begin[lower]);
+				T last = key_of(begin[upper - 1]);
+				if (!(first < key)) return lower;
+				if (last < key) return upper;
+				double fraction = (static_cast<double>(key) - static_cast<double>(first)) / (static_cast<double>(last) - static_cast<double>(first));
+				probe = lower + static_cast<size_t>(fraction * (upper - 1 - lower));
+				probe = std::min(std::max(probe, lower + 1), upper - 2);
+			}
+			else probe = lower + (upper - lower) / 2;
+			size_t size_before = upper - lower;
+			if (key_of(begin[probe]) < key) lower = probe + 1;
+			else upper = probe;
+			guess = !guess || upper - lower <= size_before / 2;
+		}
+		return lower + linear_search::lower_bound(begin + lower, upper - lower, key, key_of, comp);
+	}
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp, std::false_type)
+	{
+		return detail::std_lower_bound(begin, n, key, key_of, comp);
+	}
+};
+
+// the default: a linear scan for up to 16 elements and the branchless
+// binary search for more than that, if the keys are built-in types in one
+// array. std::lower_bound for everything else
+struct adaptive_search
+{
+	static constexpr size_t linear_threshold = 16;
+
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+	{
+		return lower_bound(begin, n, key, key_of, comp, detail::use_key_kernel<It, KeyOfValue, Comp, T>());
+	}
+
+private:
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp, std::true_type)
+	{
+		if (n <= linear_threshold) return linear_search::lower_bound(begin, n, key, key_of, comp);
+		else return branchless_search::lower_bound(begin, n, key, key_of, comp);
+	}
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp, std::false_type)
+	{
+		return detail::std_lower_bound(begin, n, key, key_of, comp);
+	}
+};
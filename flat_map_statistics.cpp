@@ -0,0 +1,104 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+#include "flat_map_statistics.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <vector>
+#include "flat_set.hpp"
+
+static_assert(sizeof(flat_map<int, int>) == sizeof(std::vector<std::pair<int, int> >), "the hooks shouldn't cost anything when they are disabled");
+
+TEST(flat_map_statistics, per_instance)
+{
+	typedef flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int> >, instrumented_search<> > instrumented_map;
+	instrumented_map map;
+	map.reserve(4);
+	for (int i : { 3, 1, 2, 4 })
+		map.emplace(i, i);
+	flat_map_statistics statistics = map.statistics();
+	ASSERT_EQ(1u, statistics.reallocations);
+	// 1 goes in front of 3, 2 in front of 3
+	ASSERT_EQ(2u, statistics.shifted);
+	ASSERT_LT(0u, statistics.comparisons);
+	ASSERT_EQ(1, map.count(2));
+	ASSERT_EQ(0, map.count(5));
+	ASSERT_EQ(map.end(), map.find(6));
+	ASSERT_EQ(4, map.at(4));
+	statistics = map.statistics();
+	ASSERT_EQ(2u, statistics.hits);
+	ASSERT_EQ(2u, statistics.misses);
+	ASSERT_DOUBLE_EQ(0.5, statistics.hit_ratio());
+	map.erase(map.begin());
+	ASSERT_EQ(5u, map.statistics().shifted);
+	// a copy starts with the counts of the original, after that they count
+	// separately
+	instrumented_map copy = map;
+	copy.count(1);
+	ASSERT_EQ(2u, map.statistics().misses);
+	ASSERT_EQ(3u, copy.statistics().misses);
+	map.reset_statistics();
+	ASSERT_EQ(0u, map.statistics().comparisons);
+	ASSERT_EQ(0u, map.statistics().hits);
+	ASSERT_EQ(0.0, map.statistics().hit_ratio());
+}
+TEST(flat_map_statistics, merge_depth)
+{
+	flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int> >, instrumented_search<> > map;
+	std::vector<std::pair<int, int> > batch;
+	for (int i = 0; i < 1000; ++i)
+		batch.emplace_back(i * 7 % 1000, i);
+	map.insert(batch.begin(), batch.end());
+	flat_map_statistics statistics = map.statistics();
+	ASSERT_EQ(1000u, map.size());
+	ASSERT_EQ(statistics.merges - 1, statistics.max_merge_depth);
+	ASSERT_LT(1u, statistics.merges);
+	// every recursion doubles the capacity, so there are about log2(1000)
+	ASSERT_GE(12u, statistics.merges);
+	ASSERT_LE(statistics.merges, statistics.reallocations);
+}
+namespace
+{
+struct session_maps;
+}
+TEST(flat_map_statistics, per_site)
+{
+	typedef instrumented_search<adaptive_search, session_maps> site_search;
+	reset_site_statistics<session_maps>();
+	static_assert(sizeof(flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int> >, site_search>) == sizeof(flat_map<int, int>), "the counts for a site are not in the map");
+	flat_map<int, int, std::less<int>, std::allocator<std::pair<int, int> >, site_search> a{ { 1, 1 }, { 2, 2 } };
+	flat_set<int, std::less<int>, std::allocator<int>, site_search> b{ 1, 2, 3 };
+	a.count(1);
+	b.count(1);
+	b.count(4);
+	flat_map_statistics statistics = site_statistics<session_maps>();
+	ASSERT_EQ(2u, statistics.hits);
+	ASSERT_EQ(1u, statistics.misses);
+	ASSERT_EQ(statistics.hits, a.statistics().hits);
+}
+
+#endif
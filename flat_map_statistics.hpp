@@ -0,0 +1,238 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "flat_map.hpp"
+
+// what a flat_map did, for finding maps that are used in a way that is
+// slow for a sorted vector, like one that gets more inserts in the middle
+// than lookups
+struct flat_map_statistics
+{
+	// every comparison that the map made, including the ones in sorts and
+	// merges. the ones made by std::lower_bound etc. on the iterators
+	// from the outside are not counted
+	std::uint64_t comparisons = 0;
+	// the elements after the position of an emplace or erase. a vector
+	// moves every one of them
+	std::uint64_t shifted = 0;
+	std::uint64_t reallocations = 0;
+	// the merges in insert(It, It). with unique keys that function calls
+	// itself once for every time that it has to grow the vector. depth 0
+	// is the first call
+	std::uint64_t merges = 0;
+	std::uint64_t max_merge_depth = 0;
+	// find, count, at, erase with a key, and find_many
+	std::uint64_t hits = 0;
+	std::uint64_t misses = 0;
+
+	double hit_ratio() const
+	{
+		std::uint64_t lookups = hits + misses;
+		return lookups ? static_cast<double>(hits) / lookups : 0.0;
+	}
+};
+
+namespace detail
+{
+// the counters behind flat_map_statistics. atomic so that several threads
+// can do lookups in the same map, or in maps that share a Site
+struct atomic_statistics
+{
+	std::atomic<std::uint64_t> comparisons{0};
+	std::atomic<std::uint64_t> shifted{0};
+	std::atomic<std::uint64_t> reallocations{0};
+	std::atomic<std::uint64_t> merges{0};
+	std::atomic<std::uint64_t> max_merge_depth{0};
+	std::atomic<std::uint64_t> hits{0};
+	std::atomic<std::uint64_t> misses{0};
+
+	atomic_statistics() = default;
+	// copying a map copies its counts
+	atomic_statistics(const atomic_statistics & other)
+	{
+		*this = other;
+	}
+	atomic_statistics & operator=(const atomic_statistics & other)
+	{
+		flat_map_statistics values = other.load();
+		comparisons = values.comparisons;
+		shifted = values.shifted;
+		reallocations = values.reallocations;
+		merges = values.merges;
+		max_merge_depth = values.max_merge_depth;
+		hits = values.hits;
+		misses = values.misses;
+		return *this;
+	}
+
+	flat_map_statistics load() const
+	{
+		flat_map_statistics result;
+		result.comparisons = comparisons.load(std::memory_order_relaxed);
+		result.shifted = shifted.load(std::memory_order_relaxed);
+		result.reallocations = reallocations.load(std::memory_order_relaxed);
+		result.merges = merges.load(std::memory_order_relaxed);
+		result.max_merge_depth = max_merge_depth.load(std::memory_order_relaxed);
+		result.hits = hits.load(std::memory_order_relaxed);
+		result.misses = misses.load(std::memory_order_relaxed);
+		return result;
+	}
+	void reset()
+	{
+		*this = atomic_statistics();
+	}
+	static void add(std::atomic<std::uint64_t> & counter, std::uint64_t amount)
+	{
+		counter.fetch_add(amount, std::memory_order_relaxed);
+	}
+	void add_merge(std::uint64_t depth)
+	{
+		add(merges, 1);
+		std::uint64_t max = max_merge_depth.load(std::memory_order_relaxed);
+		while (depth > max && !max_merge_depth.compare_exchange_weak(max, depth, std::memory_order_relaxed))
+		{
+		}
+	}
+};
+
+// wraps a comparator and counts how often it gets called. derives from the
+// comparator so that the typedefs for std::not2 are still there
+template<typename Compare>
+struct counting_compare : Compare
+{
+	counting_compare(Compare comp, std::atomic<std::uint64_t> & counter)
+		: Compare(comp), counter(&counter)
+	{
+	}
+	template<typename L, typename R>
+	bool operator()(const L & lhs, const R & rhs) const
+	{
+		atomic_statistics::add(*counter, 1);
+		return Compare::operator()(lhs, rhs);
+	}
+
+private:
+	std::atomic<std::uint64_t> * counter;
+};
+
+// where the counters live: in the map, or in one static object per Site
+template<typename Site>
+struct statistics_storage
+{
+	static atomic_statistics & counters()
+	{
+		static atomic_statistics result;
+		return result;
+	}
+};
+template<>
+struct statistics_storage<void>
+{
+	atomic_statistics & counters() const
+	{
+		return storage;
+	}
+
+private:
+	mutable atomic_statistics storage;
+};
+}
+
+// a search policy that does the same searches as Search, and counts what
+// the map does:
+// flat_map<K, V, std::less<K>, std::allocator<std::pair<K, V> >, instrumented_search<> >
+// if Site is void every map has its own counts, which map.statistics()
+// returns. otherwise all maps with the same Site add up their counts,
+// which site_statistics<Site>() returns. use a different tag type for
+// every place that creates maps that you want to tell apart. the counting
+// comparator means that lookups can't use the SIMD search, and every count
+// is an atomic increment, so this is for finding out how a map is used,
+// not for measuring how fast it is. maps with any other search policy
+// don't count anything and don't get any bigger
+template<typename Search = adaptive_search, typename Site = void>
+struct instrumented_search
+{
+	template<typename It, typename KeyOfValue, typename Comp, typename T>
+	static size_t lower_bound(It begin, size_t n, const T & key, KeyOfValue key_of, Comp comp)
+	{
+		return Search::lower_bound(begin, n, key, key_of, comp);
+	}
+};
+
+template<typename Site>
+flat_map_statistics site_statistics()
+{
+	return detail::statistics_storage<Site>::counters().load();
+}
+template<typename Site>
+void reset_site_statistics()
+{
+	detail::statistics_storage<Site>::counters().reset();
+}
+
+namespace detail
+{
+template<typename Search, typename Site>
+struct instrumentation<instrumented_search<Search, Site> > : private statistics_storage<Site>
+{
+	flat_map_statistics statistics() const
+	{
+		return this->counters().load();
+	}
+	void reset_statistics()
+	{
+		this->counters().reset();
+	}
+
+protected:
+	template<typename Compare>
+	counting_compare<Compare> counted(Compare comp) const
+	{
+		return counting_compare<Compare>(comp, this->counters().comparisons);
+	}
+	void count_lookup(bool found) const
+	{
+		atomic_statistics::add(found ? this->counters().hits : this->counters().misses, 1);
+	}
+	void count_shift(size_t num_elements) const
+	{
+		atomic_statistics::add(this->counters().shifted, num_elements);
+	}
+	void count_reallocation(size_t capacity_before, size_t capacity_after) const
+	{
+		if (capacity_before != capacity_after) atomic_statistics::add(this->counters().reallocations, 1);
+	}
+	void count_merge(size_t depth) const
+	{
+		this->counters().add_merge(depth);
+	}
+};
+}
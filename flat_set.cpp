@@ -0,0 +1,99 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "flat_set.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(flat_set, initalizer_list)
+{
+	flat_set<int> foo = { 5, 4, 5, 3 };
+	ASSERT_EQ(3u, foo.size());
+	ASSERT_EQ(1u, foo.count(5));
+	ASSERT_EQ(0u, foo.count(6));
+	ASSERT_EQ(foo.begin(), foo.find(3));
+	ASSERT_EQ(foo.end(), foo.find(2));
+	ASSERT_EQ((flat_set<int>{ 3, 4, 5 }), foo);
+}
+TEST(flat_set, insert)
+{
+	flat_set<int> foo;
+	ASSERT_TRUE(foo.insert(5).second);
+	ASSERT_FALSE(foo.insert(5).second);
+	foo.insert(foo.begin(), 3);
+	foo.insert(foo.begin(), 3);
+	ASSERT_EQ((flat_set<int>{ 3, 5 }), foo);
+	std::vector<int> bar{ 6, 8, 1, 8, 5 };
+	foo.insert(bar.begin(), bar.end());
+	ASSERT_EQ((flat_set<int>{ 1, 3, 5, 6, 8 }), foo);
+	std::vector<int> sorted{ 5, 8, 9 };
+	foo.insert(sorted_unique, sorted.begin(), sorted.end());
+	ASSERT_EQ((flat_set<int>{ 1, 3, 5, 6, 8, 9 }), foo);
+	foo.emplace(4);
+	ASSERT_EQ(3, *foo.upper_bound(1));
+	ASSERT_EQ(5, *foo.lower_bound(5));
+	ASSERT_EQ(1u, foo.erase(4));
+	ASSERT_EQ(0u, foo.erase(4));
+	ASSERT_EQ((flat_set<int>{ 1, 3, 5, 6, 8, 9 }), foo);
+}
+TEST(flat_set, strings)
+{
+	flat_set<std::string> foo{ "b", "a", "c", "a" };
+	ASSERT_EQ((std::vector<std::string>{ "a", "b", "c" }), std::move(foo).extract());
+	foo = flat_set<std::string>(std::vector<std::string>{ "z", "y", "z" });
+	ASSERT_EQ(1u, foo.count("y"));
+	ASSERT_EQ(2u, foo.size());
+}
+TEST(flat_multiset, insert)
+{
+	flat_multiset<int> foo = { 5, 4, 5, 3 };
+	ASSERT_EQ(4u, foo.size());
+	ASSERT_EQ(2u, foo.count(5));
+	foo.insert(5);
+	foo.insert(foo.begin(), 5);
+	std::vector<int> bar{ 6, 4, 1 };
+	foo.insert(bar.begin(), bar.end());
+	ASSERT_EQ((std::vector<int>{ 1, 3, 4, 4, 5, 5, 5, 5, 6 }), std::vector<int>(foo.begin(), foo.end()));
+	ASSERT_EQ(4u, foo.erase(5));
+	ASSERT_EQ(0u, foo.count(5));
+	foo.insert(sorted_equivalent, bar.begin() + 2, bar.end());
+	ASSERT_EQ((std::vector<int>{ 1, 1, 3, 4, 4, 6 }), std::vector<int>(foo.begin(), foo.end()));
+}
+TEST(flat_multiset, find_many)
+{
+	flat_multiset<int> foo = { 1, 1, 2, 4, 4, 4 };
+	std::vector<int> keys{ 4, 3, 1 };
+	std::vector<flat_multiset<int>::iterator> found;
+	foo.find_many(keys.begin(), keys.end(), std::back_inserter(found));
+	ASSERT_EQ(foo.begin() + 3, found[0]);
+	ASSERT_EQ(foo.end(), found[1]);
+	ASSERT_EQ(foo.begin(), found[2]);
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+
+// a sorted vector of keys. shares its implementation with flat_map, so it
+// has the same batch insert, the same branchless search for arithmetic keys
+// and the same find_many. the iterators are not const like in std::set, so
+// don't change the elements in a way that changes their order
+template<typename K, typename Comp = std::less<K>, typename AllocatorOrContainer = std::allocator<K>, typename Search = adaptive_search>
+struct flat_set : detail::flat_tree<K, K, detail::identity, Comp, AllocatorOrContainer, Search, true>
+{
+private:
+	typedef detail::flat_tree<K, K, detail::identity, Comp, AllocatorOrContainer, Search, true> base;
+public:
+	using base::base;
+	flat_set() = default;
+};
+
+// like flat_set, but can have several elements with the same key
+template<typename K, typename Comp = std::less<K>, typename AllocatorOrContainer = std::allocator<K>, typename Search = adaptive_search>
+struct flat_multiset : detail::flat_tree<K, K, detail::identity, Comp, AllocatorOrContainer, Search, false>
+{
+private:
+	typedef detail::flat_tree<K, K, detail::identity, Comp, AllocatorOrContainer, Search, false> base;
+public:
+	using base::base;
+	flat_multiset() = default;
+};
+
+template<typename K, typename C, typename A, typename S>
+void swap(flat_set<K, C, A, S> & lhs, flat_set<K, C, A, S> & rhs)
+{
+	lhs.swap(rhs);
+}
+template<typename K, typename C, typename A, typename S>
+void swap(flat_multiset<K, C, A, S> & lhs, flat_multiset<K, C, A, S> & rhs)
+{
+	lhs.swap(rhs);
+}
@@ -0,0 +1,77 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "frozen_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+TEST(frozen_flat_map, lookups)
+{
+	for (int size = 0; size < 100; ++size)
+	{
+		flat_map<int, int> map;
+		for (int i = 0; i < size; ++i)
+			map.emplace(i * 2, i);
+		frozen_flat_map<int, int> frozen(map);
+		ASSERT_EQ(map.size(), frozen.size());
+		ASSERT_TRUE(std::equal(map.begin(), map.end(), frozen.begin()));
+		for (int i = -1; i <= size * 2; ++i)
+		{
+			ASSERT_EQ(map.lower_bound(i) - map.begin(), frozen.lower_bound(i) - frozen.begin());
+			ASSERT_EQ(map.upper_bound(i) - map.begin(), frozen.upper_bound(i) - frozen.begin());
+			ASSERT_EQ(map.find(i) - map.begin(), frozen.find(i) - frozen.begin());
+			ASSERT_EQ(map.count(i), frozen.count(i));
+			auto range = frozen.equal_range(i);
+			ASSERT_EQ(map.equal_range(i).first - map.begin(), range.first - frozen.begin());
+			ASSERT_EQ(map.equal_range(i).second - map.begin(), range.second - frozen.begin());
+		}
+	}
+}
+TEST(frozen_flat_map, at)
+{
+	frozen_flat_map<std::string, int> frozen = freeze(flat_map<std::string, int>{ { "a", 1 }, { "c", 3 }, { "b", 2 } });
+	ASSERT_EQ(1, frozen.at("a"));
+	ASSERT_EQ(2, frozen.at("b"));
+	ASSERT_EQ(3, frozen.at("c"));
+	ASSERT_THROW(frozen.at("d"), std::out_of_range);
+	ASSERT_EQ("b", frozen.begin()[1].first);
+}
+TEST(frozen_flat_map, thaw)
+{
+	flat_map<int, std::string> map{ { 5, "five" }, { 3, "three" }, { 4, "four" } };
+	frozen_flat_map<int, std::string> frozen = freeze(std::move(map));
+	ASSERT_TRUE(map.empty());
+	ASSERT_EQ("four", frozen.at(4));
+	map = std::move(frozen).thaw();
+	ASSERT_TRUE(frozen.empty());
+	ASSERT_EQ((flat_map<int, std::string>{ { 5, "five" }, { 3, "three" }, { 4, "four" } }), map);
+}
+
+#endif
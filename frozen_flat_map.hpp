@@ -0,0 +1,233 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+
+// a read-only version of flat_map for maps that are built once and then
+// only used for lookups. the keys are copied into an Eytzinger layout:
+// the implicit binary tree where the children of node k are at 2k and
+// 2k + 1. that way the first levels of the search all share a few cache
+// lines, and the nodes that the search will look at a few steps from now
+// are next to each other so that they can be prefetched.
+// the sorted elements are kept as they were in the flat_map, so iteration
+// is the same as for a flat_map. each tree node stores where its element
+// is in the sorted array
+template<typename K, typename V, typename Comp = std::less<K>, typename Allocator = std::allocator<std::pair<K, V> > >
+struct frozen_flat_map
+{
+	typedef flat_map<K, V, Comp, Allocator> map_type;
+	typedef typename map_type::key_type key_type;
+	typedef typename map_type::mapped_type mapped_type;
+	typedef typename map_type::value_type value_type;
+	typedef typename map_type::key_compare key_compare;
+	typedef typename map_type::value_compare value_compare;
+	typedef typename map_type::allocator_type allocator_type;
+	typedef typename map_type::container_type container_type;
+	typedef typename container_type::const_iterator iterator;
+	typedef typename container_type::const_iterator const_iterator;
+	typedef typename container_type::const_reverse_iterator reverse_iterator;
+	typedef typename container_type::const_reverse_iterator const_reverse_iterator;
+	typedef typename container_type::difference_type difference_type;
+	typedef typename container_type::size_type size_type;
+
+	frozen_flat_map() = default;
+	explicit frozen_flat_map(const map_type & map)
+		: sorted(map.begin(), map.end())
+	{
+		build_tree();
+	}
+	explicit frozen_flat_map(map_type && map)
+		: sorted(std::move(map).extract())
+	{
+		build_tree();
+	}
+
+	const_iterator			begin()		const	{	return sorted.begin();		}
+	const_iterator			end()		const	{	return sorted.end();		}
+	const_iterator			cbegin()	const	{	return sorted.cbegin();		}
+	const_iterator			cend()		const	{	return sorted.cend();		}
+	const_reverse_iterator	rbegin()	const	{	return sorted.rbegin();		}
+	const_reverse_iterator	rend()		const	{	return sorted.rend();		}
+	const_reverse_iterator	crbegin()	const	{	return sorted.crbegin();	}
+	const_reverse_iterator	crend()		const	{	return sorted.crend();		}
+
+	bool empty() const
+	{
+		return sorted.empty();
+	}
+	size_type size() const
+	{
+		return sorted.size();
+	}
+
+	const mapped_type & at(const key_type & key) const
+	{
+		auto found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	template<typename T>
+	const_iterator find(const T & key) const
+	{
+		size_type node = lower_bound_node(key);
+		if (node == 0 || key_compare()(key, tree[node - 1])) return end();
+		else return begin() + positions[node - 1];
+	}
+	template<typename T>
+	size_type count(const T & key) const
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+	template<typename T>
+	const_iterator lower_bound(const T & key) const
+	{
+		return node_to_iterator(lower_bound_node(key));
+	}
+	template<typename T>
+	const_iterator upper_bound(const T & key) const
+	{
+		return node_to_iterator(descend(key, [](const key_type & node, const T & key)
+		{
+			return !key_compare()(key, node);
+		}));
+	}
+	template<typename T>
+	std::pair<const_iterator, const_iterator> equal_range(const T & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		if (lower == end() || key_compare()(key, lower->first)) return { lower, lower };
+		else return { lower, lower + 1 };
+	}
+
+	key_compare key_comp() const
+	{
+		return key_compare();
+	}
+	value_compare value_comp() const
+	{
+		return value_compare();
+	}
+	allocator_type get_allocator() const
+	{
+		return sorted.get_allocator();
+	}
+
+	// turns this back into a normal flat_map
+	map_type thaw() &&
+	{
+		map_type result(sorted_unique, std::move(sorted));
+		sorted.clear();
+		tree.clear();
+		positions.clear();
+		return result;
+	}
+
+	bool operator==(const frozen_flat_map & other) const
+	{
+		return sorted == other.sorted;
+	}
+	bool operator!=(const frozen_flat_map & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<key_type> key_allocator;
+	typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<size_type> size_allocator;
+
+	container_type sorted;
+	// tree[k - 1] is node k of the Eytzinger tree, and positions[k - 1]
+	// is the index of that key in sorted
+	std::vector<key_type, key_allocator> tree;
+	std::vector<size_type, size_allocator> positions;
+
+	void build_tree()
+	{
+		positions.resize(sorted.size());
+		build_positions(0, 1);
+		tree.reserve(sorted.size());
+		for (size_type position : positions)
+			tree.push_back(sorted[position].first);
+	}
+	// an in-order walk over the implicit tree visits the nodes in sorted order
+	size_type build_positions(size_type index, size_type node)
+	{
+		if (node > positions.size()) return index;
+		index = build_positions(index, 2 * node);
+		positions[node - 1] = index++;
+		return build_positions(index, 2 * node + 1);
+	}
+
+	// walks down the tree, going right whenever go_right returns true.
+	// returns the last node where it went left, which is the first node
+	// for which go_right returned false. returns 0 if there is no such node
+	template<typename T, typename GoRight>
+	size_type descend(const T & key, GoRight go_right) const
+	{
+		// a cache line holds the nodes that are four levels further down
+		// if keys are four bytes, so fetch those before they are needed
+		const size_type nodes_per_line = sizeof(key_type) < 64 ? 64 / sizeof(key_type) : 1;
+		const key_type * nodes = tree.data();
+		size_type num_nodes = tree.size();
+		size_type node = 1;
+		while (node <= num_nodes)
+		{
+			size_type prefetch = node * nodes_per_line;
+			if (prefetch < num_nodes) __builtin_prefetch(nodes + prefetch - 1);
+			node = 2 * node + go_right(nodes[node - 1], key);
+		}
+		// the trailing ones in node are the right turns at the end.
+		// the last left turn is where the result is
+		return node >> __builtin_ffsll(static_cast<long long>(~node));
+	}
+	template<typename T>
+	size_type lower_bound_node(const T & key) const
+	{
+		return descend(key, [](const key_type & node, const T & key)
+		{
+			return key_compare()(node, key);
+		});
+	}
+	const_iterator node_to_iterator(size_type node) const
+	{
+		if (node == 0) return end();
+		else return begin() + positions[node - 1];
+	}
+};
+
+template<typename K, typename V, typename C, typename A>
+frozen_flat_map<K, V, C, A> freeze(flat_map<K, V, C, A> && map)
+{
+	return frozen_flat_map<K, V, C, A>(std::move(map));
+}
+template<typename K, typename V, typename C, typename A>
+frozen_flat_map<K, V, C, A> freeze(const flat_map<K, V, C, A> & map)
+{
+	return frozen_flat_map<K, V, C, A>(map);
+}
@@ -0,0 +1,116 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "hashed_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+TEST(hashed_flat_map, same_as_flat_map)
+{
+	std::mt19937 randomness(5);
+	flat_map<int, int> expected;
+	hashed_flat_map<int, int> hashed;
+	for (int i = 0; i < 2000; ++i)
+	{
+		int key = static_cast<int>(randomness() % 1000);
+		auto expected_inserted = expected.emplace(key, i);
+		auto inserted = hashed.emplace(key, i);
+		ASSERT_EQ(expected_inserted.second, inserted.second);
+		ASSERT_EQ(*expected_inserted.first, *inserted.first);
+		if (i % 7 == 0)
+			ASSERT_EQ(expected.erase(key + 1), hashed.erase(key + 1));
+		int lookup = static_cast<int>(randomness() % 1000);
+		ASSERT_EQ(expected.count(lookup), hashed.count(lookup));
+		ASSERT_TRUE(hashed.is_indexed());
+		const hashed_flat_map<int, int> & const_hashed = hashed;
+		ASSERT_EQ(expected.find(lookup) - expected.begin(), const_hashed.find(lookup) - const_hashed.begin());
+		ASSERT_EQ(expected.lower_bound(lookup) - expected.begin(), hashed.lower_bound(lookup) - hashed.begin());
+	}
+	ASSERT_EQ(expected, hashed.as_flat_map());
+}
+TEST(hashed_flat_map, lookups)
+{
+	hashed_flat_map<std::string, int> map = { { "b", 2 }, { "d", 4 } };
+	map["c"] = 3;
+	map.emplace("a", 1);
+	ASSERT_FALSE(map.is_indexed());
+	const hashed_flat_map<std::string, int> & const_map = map;
+	// the const version falls back to the binary search
+	ASSERT_EQ(3, const_map.at("c"));
+	ASSERT_FALSE(map.is_indexed());
+	ASSERT_EQ(1, map.at("a"));
+	ASSERT_TRUE(map.is_indexed());
+	ASSERT_EQ(2, const_map.at("b"));
+	ASSERT_THROW(map.at("e"), std::out_of_range);
+	ASSERT_EQ(map.end(), map.find("e"));
+	map.find("d")->second = 5;
+	ASSERT_EQ(5, map.upper_bound("c")->second);
+	std::string keys;
+	for (const auto & kv : map)
+		keys += kv.first;
+	ASSERT_EQ("abcd", keys);
+}
+TEST(hashed_flat_map, keeps_index)
+{
+	hashed_flat_map<int, int> map;
+	map.emplace(1, 1);
+	map.build_index();
+	// appending doesn't throw the table away until it is half full
+	for (int i = 2; i < 100; ++i)
+	{
+		map.emplace(i, i);
+		ASSERT_EQ(i, map.find(i)->second);
+	}
+	ASSERT_TRUE(map.is_indexed());
+	map.emplace(0, 0);
+	ASSERT_FALSE(map.is_indexed());
+	ASSERT_EQ(0, map[0]);
+	ASSERT_TRUE(map.is_indexed());
+	// the batch insert rebuilds right away
+	std::vector<std::pair<int, int> > batch = { { -1, -1 }, { 200, 200 }, { 50, 0 } };
+	map.insert(batch.begin(), batch.end());
+	ASSERT_TRUE(map.is_indexed());
+	ASSERT_EQ(102u, map.size());
+	for (int i = -1; i < 100; ++i)
+		ASSERT_EQ(i, map.find(i)->first);
+	ASSERT_EQ(50, map.at(50));
+	ASSERT_EQ(200, map.at(200));
+	ASSERT_EQ(51u, map.erase_if([](const std::pair<int, int> & kv)
+	{
+		return kv.first % 2 != 0;
+	}));
+	ASSERT_EQ(0u, map.count(1));
+	ASSERT_EQ(1u, map.count(2));
+	map.clear();
+	ASSERT_EQ(0u, map.count(2));
+}
+
+#endif
@@ -0,0 +1,355 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <cstdint>
+#include <limits>
+
+// a flat_map with a hash table on the side for point lookups. the table is
+// open addressed and only stores 32 bit positions in the sorted vector, so
+// it costs between 8 and 16 bytes per element. find, count, at and
+// operator[] hash the key and usually look at a single slot and a single
+// element. lower_bound, upper_bound, equal_range and iteration go to the
+// sorted vector as in a flat_map.
+//
+// most changes shift the positions of the elements, so instead of fixing
+// the table up on every change it gets thrown away and is rebuilt in O(n)
+// by the next lookup. appending an element that is bigger than all others
+// only adds a slot. the batch insert rebuilds right away if there was a
+// table, because it already did O(n) work on the vector.
+//
+// the const lookups don't rebuild the table, so that several threads can
+// read at the same time. if the table is out of date, they do a binary
+// search instead. call build_index() after changing the map if that matters.
+//
+// the keys have to be hashed by Hash in a way that keys which are
+// equivalent according to Comp get the same hash
+template<typename K, typename V, typename Comp = std::less<K>, typename Hash = std::hash<K>, typename AllocatorOrContainer = std::allocator<std::pair<K, V> >, typename Search = adaptive_search>
+struct hashed_flat_map
+{
+	typedef flat_map<K, V, Comp, AllocatorOrContainer, Search> map_type;
+	typedef typename map_type::key_type key_type;
+	typedef typename map_type::mapped_type mapped_type;
+	typedef typename map_type::value_type value_type;
+	typedef typename map_type::key_compare key_compare;
+	typedef typename map_type::value_compare value_compare;
+	typedef Hash hasher;
+	typedef typename map_type::allocator_type allocator_type;
+	typedef typename map_type::iterator iterator;
+	typedef typename map_type::const_iterator const_iterator;
+	typedef typename map_type::reverse_iterator reverse_iterator;
+	typedef typename map_type::const_reverse_iterator const_reverse_iterator;
+	typedef typename map_type::difference_type difference_type;
+	typedef typename map_type::size_type size_type;
+
+	hashed_flat_map() = default;
+	explicit hashed_flat_map(map_type map)
+		: map(std::move(map))
+	{
+	}
+	template<typename It>
+	hashed_flat_map(It begin, It end)
+		: map(begin, end)
+	{
+	}
+	hashed_flat_map(std::initializer_list<value_type> init)
+		: map(init)
+	{
+	}
+
+	// the keys must not be changed through these iterators, same as in a flat_map
+	iterator				begin()				{	return map.begin();		}
+	iterator				end()				{	return map.end();		}
+	const_iterator			begin()		const	{	return map.begin();		}
+	const_iterator			end()		const	{	return map.end();		}
+	const_iterator			cbegin()	const	{	return map.cbegin();	}
+	const_iterator			cend()		const	{	return map.cend();		}
+	reverse_iterator		rbegin()			{	return map.rbegin();	}
+	reverse_iterator		rend()				{	return map.rend();		}
+	const_reverse_iterator	rbegin()	const	{	return map.rbegin();	}
+	const_reverse_iterator	rend()		const	{	return map.rend();		}
+
+	bool empty() const
+	{
+		return map.empty();
+	}
+	size_type size() const
+	{
+		return map.size();
+	}
+	void reserve(size_type size)
+	{
+		map.reserve(size);
+	}
+
+	mapped_type & operator[](const key_type & key)
+	{
+		iterator found = find(key);
+		if (found != end()) return found->second;
+		return emplace(key, mapped_type()).first->second;
+	}
+	mapped_type & operator[](key_type && key)
+	{
+		iterator found = find(key);
+		if (found != end()) return found->second;
+		return emplace(std::move(key), mapped_type()).first->second;
+	}
+	mapped_type & at(const key_type & key)
+	{
+		iterator found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	const mapped_type & at(const key_type & key) const
+	{
+		const_iterator found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+
+	std::pair<iterator, bool> insert(value_type && value)
+	{
+		return emplace(std::move(value));
+	}
+	std::pair<iterator, bool> insert(const value_type & value)
+	{
+		return emplace(value);
+	}
+	template<typename It>
+	void insert(It begin, It end)
+	{
+		map.insert(begin, end);
+		rebuild_if_indexed();
+	}
+	template<typename It>
+	void insert(sorted_unique_t, It begin, It end)
+	{
+		map.insert(sorted_unique, begin, end);
+		rebuild_if_indexed();
+	}
+	void insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+	template<typename... Args>
+	std::pair<iterator, bool> emplace(Args &&... args)
+	{
+		auto inserted = map.emplace(std::forward<Args>(args)...);
+		if (!inserted.second) return inserted;
+		size_type position = inserted.first - map.begin();
+		// an append doesn't move any other element, so only the new one
+		// needs a slot, as long as the table doesn't get too full
+		if (indexed && position + 1 == map.size() && map.size() <= slots.size() / 2)
+			add_to_index(position);
+		else
+			indexed = false;
+		return inserted;
+	}
+	iterator erase(const_iterator it)
+	{
+		indexed = false;
+		return map.erase(it);
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		indexed = false;
+		return map.erase(first, last);
+	}
+	// doesn't use the table, because it would be out of date afterwards
+	size_type erase(const key_type & key)
+	{
+		size_type num_erased = map.erase(key);
+		if (num_erased) indexed = false;
+		return num_erased;
+	}
+	template<typename Pred>
+	size_type erase_if(Pred pred)
+	{
+		size_type num_erased = map.erase_if(pred);
+		if (num_erased) indexed = false;
+		return num_erased;
+	}
+	void swap(hashed_flat_map & other)
+	{
+		map.swap(other.map);
+		slots.swap(other.slots);
+		std::swap(shift, other.shift);
+		std::swap(indexed, other.indexed);
+	}
+	void clear()
+	{
+		map.clear();
+		indexed = false;
+	}
+
+	iterator find(const key_type & key)
+	{
+		if (!indexed) build_index();
+		if (!indexed) return map.find(key);
+		return begin() + indexed_find(key);
+	}
+	const_iterator find(const key_type & key) const
+	{
+		if (!indexed) return map.find(key);
+		return begin() + indexed_find(key);
+	}
+	size_type count(const key_type & key)
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+	size_type count(const key_type & key) const
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+	template<typename T>
+	iterator lower_bound(const T & key)
+	{
+		return map.lower_bound(key);
+	}
+	template<typename T>
+	const_iterator lower_bound(const T & key) const
+	{
+		return map.lower_bound(key);
+	}
+	template<typename T>
+	iterator upper_bound(const T & key)
+	{
+		return map.upper_bound(key);
+	}
+	template<typename T>
+	const_iterator upper_bound(const T & key) const
+	{
+		return map.upper_bound(key);
+	}
+	template<typename T>
+	std::pair<iterator, iterator> equal_range(const T & key)
+	{
+		return map.equal_range(key);
+	}
+	template<typename T>
+	std::pair<const_iterator, const_iterator> equal_range(const T & key) const
+	{
+		return map.equal_range(key);
+	}
+
+	// builds the hash table if it is out of date. a map with more than
+	// 2^31 elements doesn't get one, and uses binary search for everything
+	void build_index()
+	{
+		indexed = false;
+		if (map.empty() || map.size() > std::numeric_limits<std::uint32_t>::max() / 2)
+		{
+			slots.clear();
+			return;
+		}
+		// a power of two that is at least twice the size
+		shift = 63;
+		while ((size_type(1) << (64 - shift)) < map.size() * 2)
+			--shift;
+		slots.assign(size_type(1) << (64 - shift), 0);
+		for (size_type i = 0; i < map.size(); ++i)
+			add_to_index(i);
+		indexed = true;
+	}
+	bool is_indexed() const
+	{
+		return indexed;
+	}
+	// bytes used by the hash table, not counting the elements
+	size_type index_memory_usage() const
+	{
+		return slots.capacity() * sizeof(std::uint32_t);
+	}
+	const map_type & as_flat_map() const
+	{
+		return map;
+	}
+	// moves the map out, leaving this empty
+	map_type extract() &&
+	{
+		indexed = false;
+		return std::move(map);
+	}
+
+	bool operator==(const hashed_flat_map & other) const
+	{
+		return map == other.map;
+	}
+	bool operator!=(const hashed_flat_map & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	map_type map;
+	// position + 1 of an element in the map, 0 for an empty slot
+	std::vector<std::uint32_t> slots;
+	// 64 - log2(slots.size())
+	int shift = 63;
+	bool indexed = false;
+
+	// multiplies the hash by 2^64 / phi and takes the top bits, because
+	// std::hash of an integer is often the integer itself
+	size_type home_slot(const key_type & key) const
+	{
+		std::uint64_t hash = static_cast<std::uint64_t>(hasher()(key));
+		return static_cast<size_type>((hash * 0x9e3779b97f4a7c15ull) >> shift);
+	}
+	void add_to_index(size_type position)
+	{
+		size_type mask = slots.size() - 1;
+		size_type slot = home_slot((map.begin() + position)->first);
+		while (slots[slot])
+			slot = (slot + 1) & mask;
+		slots[slot] = static_cast<std::uint32_t>(position + 1);
+	}
+	// returns size() if the key is not in the map
+	size_type indexed_find(const key_type & key) const
+	{
+		key_compare comp;
+		size_type mask = slots.size() - 1;
+		for (size_type slot = home_slot(key);; slot = (slot + 1) & mask)
+		{
+			std::uint32_t position = slots[slot];
+			if (!position) return map.size();
+			const key_type & other = (map.begin() + (position - 1))->first;
+			if (!comp(key, other) && !comp(other, key)) return position - 1;
+		}
+	}
+	void rebuild_if_indexed()
+	{
+		if (indexed) build_index();
+	}
+};
+
+template<typename K, typename V, typename C, typename H, typename A, typename S>
+void swap(hashed_flat_map<K, V, C, H, A, S> & lhs, hashed_flat_map<K, V, C, H, A, S> & rhs)
+{
+	lhs.swap(rhs);
+}
@@ -0,0 +1,117 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "learned_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+template<typename K, size_t Epsilon>
+void check_learned_lookups(const std::vector<K> & keys)
+{
+	flat_map<K, int> map;
+	for (K key : keys)
+		map.emplace(key, 0);
+	learned_flat_map<K, int, Epsilon> learned(map);
+	ASSERT_EQ(map.size(), learned.size());
+	ASSERT_LE(learned.max_error(), Epsilon + 1);
+	std::vector<K> lookups;
+	for (K key : keys)
+	{
+		lookups.push_back(key);
+		lookups.push_back(key - 1);
+		lookups.push_back(key + 1);
+	}
+	lookups.push_back(std::numeric_limits<K>::min());
+	lookups.push_back(std::numeric_limits<K>::max());
+	for (K key : lookups)
+	{
+		ASSERT_EQ(map.lower_bound(key) - map.begin(), learned.lower_bound(key) - learned.begin());
+		ASSERT_EQ(map.upper_bound(key) - map.begin(), learned.upper_bound(key) - learned.begin());
+		ASSERT_EQ(map.find(key) - map.begin(), learned.find(key) - learned.begin());
+		ASSERT_EQ(map.count(key), learned.count(key));
+	}
+}
+}
+
+TEST(learned_flat_map, lookups)
+{
+	std::mt19937_64 randomness(5);
+	for (size_t size : { 0, 1, 2, 3, 100, 10000 })
+	{
+		std::vector<std::uint64_t> uniform;
+		std::vector<std::int64_t> clustered;
+		std::vector<int> dense;
+		for (size_t i = 0; i < size; ++i)
+		{
+			uniform.push_back(randomness());
+			// a few clusters that are far apart, with a gap in the middle
+			clustered.push_back(static_cast<std::int64_t>((i % 5) * 1000000000000ll - 2000000000000ll + randomness() % 100000));
+			dense.push_back(static_cast<int>(i) - 50 + static_cast<int>(i / 7) * 3);
+		}
+		check_learned_lookups<std::uint64_t, 32>(uniform);
+		check_learned_lookups<std::int64_t, 32>(clustered);
+		check_learned_lookups<std::int64_t, 1>(clustered);
+		check_learned_lookups<int, 8>(dense);
+	}
+}
+TEST(learned_flat_map, levels)
+{
+	std::mt19937_64 randomness(5);
+	std::vector<std::uint64_t> keys;
+	for (size_t i = 0; i < 100000; ++i)
+		keys.push_back(randomness());
+	std::sort(keys.begin(), keys.end());
+	detail::learned_index<std::uint64_t> index(reinterpret_cast<const char *>(keys.data()), sizeof(std::uint64_t), keys.size(), 1, 1);
+	// the test is only interesting if lookups go through several levels
+	ASSERT_LE(3u, index.num_levels());
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		ASSERT_EQ(i, index.lower_bound(reinterpret_cast<const char *>(keys.data()), sizeof(std::uint64_t), keys.size(), keys[i]));
+		ASSERT_EQ(i + 1, index.lower_bound(reinterpret_cast<const char *>(keys.data()), sizeof(std::uint64_t), keys.size(), keys[i] + 1));
+	}
+}
+TEST(learned_flat_map, memory_usage)
+{
+	flat_map<std::uint64_t, std::uint64_t> map;
+	for (std::uint64_t i = 0; i < 100000; ++i)
+		map.emplace(i * 10, i);
+	learned_flat_map<std::uint64_t, std::uint64_t> learned(std::move(map));
+	// evenly spread keys fit on a single line
+	ASSERT_EQ(0u, learned.max_error());
+	ASSERT_LT(learned.memory_usage(), 1000u);
+	ASSERT_EQ(500u, learned.at(5000));
+	ASSERT_THROW(learned.at(5001), std::out_of_range);
+	flat_map<std::uint64_t, std::uint64_t> thawed = std::move(learned).thaw();
+	ASSERT_EQ(100000u, thawed.size());
+}
+
+#endif
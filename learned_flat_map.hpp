@@ -0,0 +1,315 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <cmath>
+#include <limits>
+
+namespace detail
+{
+// a PGM style learned index over a sorted array of unique integer keys.
+// the keys are split into segments, and in each segment the position of a
+// key is predicted with a straight line. the lines are chosen so that no
+// prediction is off by more than epsilon. the first keys of the segments
+// form a smaller sorted array, which gets the same treatment with a smaller
+// epsilon, until there are few enough segments to fit in the cache. a
+// lookup does a binary search over those and then goes down the levels,
+// and on each level searches only the few elements around the prediction. the keys themselves are not copied, the index only needs to
+// be given the same array again for every lookup
+template<typename K>
+struct learned_index
+{
+	static_assert(std::is_integral<K>::value && !std::is_same<K, bool>::value, "the learned index only works for integer keys");
+
+	learned_index() = default;
+	learned_index(const char * keys, size_t stride, size_t n, size_t epsilon, size_t upper_epsilon)
+	{
+		const char * level_keys = keys;
+		size_t level_stride = stride;
+		size_t level_size = n;
+		for (size_t level_epsilon = epsilon; level_size > 0; level_epsilon = upper_epsilon)
+		{
+			levels.emplace_back();
+			level & current = levels.back();
+			current.epsilon = level_epsilon;
+			build_segments(current, level_keys, level_stride, level_size);
+			if (current.segments.size() <= top_level_size) break;
+			level_keys = reinterpret_cast<const char *>(std::addressof(current.segments.front().key));
+			level_stride = sizeof(segment);
+			level_size = current.segments.size();
+		}
+	}
+
+	// the index of the first key that is not less than key
+	size_t lower_bound(const char * keys, size_t stride, size_t n, K key) const
+	{
+		if (levels.empty() || key <= key_at<K>(keys, stride, 0)) return 0;
+		// the top level is small enough to stay in the cache, so it is
+		// searched without a model
+		const std::vector<segment> & top = levels.back().segments;
+		size_t segment_index = branchless_lower_bound(reinterpret_cast<const char *>(std::addressof(top.front().key)), sizeof(segment), top.size(), key);
+		segment_index += segment_index < top.size() && top[segment_index].key == key;
+		segment_index -= 1;
+		for (size_t i = levels.size(); i-- > 0;)
+		{
+			const char * level_keys = i == 0 ? keys : reinterpret_cast<const char *>(std::addressof(levels[i - 1].segments.front().key));
+			size_t level_stride = i == 0 ? stride : sizeof(segment);
+			size_t level_size = i == 0 ? n : levels[i - 1].segments.size();
+			size_t position = lower_bound_in_segment(levels[i], segment_index, level_keys, level_stride, level_size, key);
+			if (i == 0) return position;
+			// the key belongs to the last segment that starts at or before it
+			bool found = position < level_size && key_at<K>(level_keys, level_stride, position) == key;
+			segment_index = position + found - 1;
+		}
+		return 0;
+	}
+
+	// the biggest distance between a predicted and an actual position, on
+	// the lowest level. never more than the epsilon that the index was built
+	// with, plus one for rounding
+	size_t max_error() const
+	{
+		return levels.empty() ? 0 : levels.front().max_error;
+	}
+	size_t num_levels() const
+	{
+		return levels.size();
+	}
+	size_t num_segments() const
+	{
+		return levels.empty() ? 0 : levels.front().segments.size();
+	}
+	// bytes used by the index, not counting the keys
+	size_t memory_usage() const
+	{
+		size_t result = sizeof(*this) + levels.capacity() * sizeof(level);
+		for (const level & level : levels)
+			result += level.segments.capacity() * sizeof(segment);
+		return result;
+	}
+
+private:
+	static constexpr size_t top_level_size = 256;
+	typedef typename std::make_unsigned<K>::type unsigned_key;
+	struct segment
+	{
+		K key;
+		size_t position;
+		double slope;
+	};
+	struct level
+	{
+		std::vector<segment> segments;
+		size_t epsilon = 0;
+		size_t max_error = 0;
+	};
+	std::vector<level> levels;
+
+	static double distance(K from, K to)
+	{
+		// unsigned so that the difference can't overflow
+		return static_cast<double>(static_cast<unsigned_key>(static_cast<unsigned_key>(to) - static_cast<unsigned_key>(from)));
+	}
+	// the prediction is clamped to the positions of the segment, so it never
+	// decreases when the key increases. that makes the error for keys that
+	// are not in the array at most one bigger than for keys that are
+	static size_t predict(const segment & segment, size_t end, K key)
+	{
+		double predicted = static_cast<double>(segment.position) + segment.slope * distance(segment.key, key);
+		return std::min(static_cast<size_t>(predicted), end);
+	}
+	// the shrinking cone algorithm: keep the range of slopes that predicts
+	// every key so far within epsilon. once that range is empty, the key
+	// that made it empty starts a new segment. O(n) for the whole array
+	static void build_segments(level & level, const char * keys, size_t stride, size_t n)
+	{
+		double epsilon = static_cast<double>(level.epsilon);
+		for (size_t begin = 0; begin < n;)
+		{
+			K first = key_at<K>(keys, stride, begin);
+			double lowest = 0.0;
+			double highest = std::numeric_limits<double>::infinity();
+			size_t end = begin + 1;
+			for (; end < n; ++end)
+			{
+				double x = distance(first, key_at<K>(keys, stride, end));
+				double y = static_cast<double>(end - begin);
+				double new_lowest = std::max(lowest, (y - epsilon) / x);
+				double new_highest = std::min(highest, (y + epsilon) / x);
+				if (new_lowest > new_highest) break;
+				lowest = new_lowest;
+				highest = new_highest;
+			}
+			double slope = end == begin + 1 ? 0.0 : (lowest + highest) / 2.0;
+			level.segments.push_back({ first, begin, slope });
+			for (size_t i = begin; i < end; ++i)
+			{
+				size_t predicted = predict(level.segments.back(), end, key_at<K>(keys, stride, i));
+				level.max_error = std::max(level.max_error, predicted > i ? predicted - i : i - predicted);
+			}
+			begin = end;
+		}
+	}
+	// lower bound of key among the keys of one segment and the first key
+	// after the segment. only looks at the keys within max_error + 1 of
+	// the prediction
+	size_t lower_bound_in_segment(const level & level, size_t segment_index, const char * keys, size_t stride, size_t n, K key) const
+	{
+		const segment & segment = level.segments[segment_index];
+		size_t end = segment_index + 1 == level.segments.size() ? n : level.segments[segment_index + 1].position;
+		size_t predicted = predict(segment, end, key);
+		size_t error = level.max_error + 1;
+		size_t lower = std::max(segment.position, predicted > error ? predicted - error : 0);
+		size_t upper = std::min(end, predicted + error);
+		return lower + branchless_lower_bound(keys + lower * stride, stride, upper - lower, key);
+	}
+};
+}
+
+// a read-only flat_map for big tables of integer keys, with a learned index
+// on top. the elements stay in the same sorted vector as in the flat_map,
+// the index only adds a few bytes per segment of keys. Epsilon is the
+// maximum error of the predictions on the lowest level: each lookup does a
+// search over about 2 * Epsilon keys there, and a search over about
+// 2 * upper_epsilon keys on each of the few levels above that. bigger
+// Epsilon means fewer segments and a smaller index but more keys to search
+template<typename K, typename V, size_t Epsilon = 16, typename Allocator = std::allocator<std::pair<K, V> > >
+struct learned_flat_map
+{
+	typedef flat_map<K, V, std::less<K>, Allocator> map_type;
+	typedef typename map_type::key_type key_type;
+	typedef typename map_type::mapped_type mapped_type;
+	typedef typename map_type::value_type value_type;
+	typedef typename map_type::key_compare key_compare;
+	typedef typename map_type::const_iterator iterator;
+	typedef typename map_type::const_iterator const_iterator;
+	typedef typename map_type::const_reverse_iterator reverse_iterator;
+	typedef typename map_type::const_reverse_iterator const_reverse_iterator;
+	typedef typename map_type::difference_type difference_type;
+	typedef typename map_type::size_type size_type;
+	static constexpr size_t upper_epsilon = 4;
+
+	learned_flat_map() = default;
+	explicit learned_flat_map(const map_type & map)
+		: map(map)
+	{
+		build_index();
+	}
+	explicit learned_flat_map(map_type && map)
+		: map(std::move(map))
+	{
+		build_index();
+	}
+
+	const_iterator			begin()		const	{	return map.begin();		}
+	const_iterator			end()		const	{	return map.end();		}
+	const_iterator			cbegin()	const	{	return map.cbegin();	}
+	const_iterator			cend()		const	{	return map.cend();		}
+	const_reverse_iterator	rbegin()	const	{	return map.rbegin();	}
+	const_reverse_iterator	rend()		const	{	return map.rend();		}
+	const_reverse_iterator	crbegin()	const	{	return map.crbegin();	}
+	const_reverse_iterator	crend()		const	{	return map.crend();		}
+
+	bool empty() const
+	{
+		return map.empty();
+	}
+	size_type size() const
+	{
+		return map.size();
+	}
+
+	const mapped_type & at(const key_type & key) const
+	{
+		auto found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	const_iterator find(const key_type & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		if (lower == end() || key < lower->first) return end();
+		else return lower;
+	}
+	size_type count(const key_type & key) const
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+	const_iterator lower_bound(const key_type & key) const
+	{
+		if (map.empty()) return end();
+		return begin() + index.lower_bound(keys(), sizeof(value_type), map.size(), key);
+	}
+	const_iterator upper_bound(const key_type & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		return lower == end() || key < lower->first ? lower : lower + 1;
+	}
+	std::pair<const_iterator, const_iterator> equal_range(const key_type & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		if (lower == end() || key < lower->first) return { lower, lower };
+		else return { lower, lower + 1 };
+	}
+
+	// the biggest error of a prediction on the lowest level
+	size_t max_error() const
+	{
+		return index.max_error();
+	}
+	// bytes used by the index on top of the elements
+	size_t memory_usage() const
+	{
+		return index.memory_usage();
+	}
+	const map_type & as_flat_map() const
+	{
+		return map;
+	}
+	// turns this back into a normal flat_map
+	map_type thaw() &&
+	{
+		index = detail::learned_index<K>();
+		return std::move(map);
+	}
+
+private:
+	map_type map;
+	detail::learned_index<K> index;
+
+	const char * keys() const
+	{
+		return reinterpret_cast<const char *>(std::addressof(map.begin()->first));
+	}
+	void build_index()
+	{
+		if (map.empty()) index = detail::learned_index<K>();
+		else index = detail::learned_index<K>(keys(), sizeof(value_type), map.size(), Epsilon, upper_epsilon);
+	}
+};
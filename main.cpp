@@ -40,17 +40,37 @@ USE_STRUCTS_512(CONCAT(i, 0))
 #endif
 
 #ifdef COMPILE_UNIQUE_PTR
-#include "dunique_ptr.hpp"
-#include <memory>
-
+#	ifdef STD_UNIQUE_PTR
+#		include <memory>
+template<typename T, typename D = std::default_delete<T> >
+using unique_ptr_type = std::unique_ptr<T, D>;
+#	else
+#		include "dunique_ptr.hpp"
+#		include <memory>
 template<typename T, typename D = std::default_delete<T> >
 using unique_ptr_type = dunique_ptr<T, D>;
+#	endif
+#	ifdef CUSTOM_DELETER
+struct pool_delete
+{
+	template<typename T>
+	void operator()(T * ptr) const
+	{
+		delete ptr;
+	}
+};
+template<typename T>
+using delete_type = pool_delete;
+#	else
+template<typename T>
+using delete_type = std::default_delete<T>;
+#	endif
 
 #	define USE_A_STRUCT(i)\
 struct CONCAT(A, i)\
 {\
 };\
-unique_ptr_type<CONCAT(A, i)> CONCAT(ptr, i)
+unique_ptr_type<CONCAT(A, i), delete_type<CONCAT(A, i)> > CONCAT(ptr, i)
 INSTANTIATE(NUM_ITERATIONS);
 #endif
 
@@ -79,6 +99,85 @@ flat_map_type<int, CONCAT(A, i)> CONCAT(static, i) = CONCAT(foo, i)()
 INSTANTIATE(NUM_ITERATIONS);
 #endif
 
+#ifdef COMPILE_FLAT_MULTIMAP
+#	ifdef BOOST_FLAT_MAP
+#		include <boost/container/flat_map.hpp>
+template<typename K, typename V, typename C = std::less<K>, typename A = std::allocator<std::pair<K, V> > >
+using flat_multimap_type = boost::container::flat_multimap<K, V, C, A>;
+#	else
+#		include "flat_map.hpp"
+template<typename K, typename V, typename C = std::less<K>, typename A = std::allocator<std::pair<K, V> > >
+using flat_multimap_type = flat_multimap<K, V, C, A>;
+#	endif
+#	define USE_A_STRUCT(i)\
+struct CONCAT(A, i)\
+{\
+};\
+flat_multimap_type<int, CONCAT(A, i)> CONCAT(foo, i)()\
+{\
+	flat_multimap_type<int, CONCAT(A, i)> map;\
+	map.emplace();\
+	map.erase(0);\
+	return map;\
+}\
+flat_multimap_type<int, CONCAT(A, i)> CONCAT(static, i) = CONCAT(foo, i)()
+INSTANTIATE(NUM_ITERATIONS);
+#endif
+
+#if defined(COMPILE_FLAT_SET) || defined(COMPILE_FLAT_MULTISET)
+#	ifdef BOOST_FLAT_MAP
+#		include <boost/container/flat_set.hpp>
+#		ifdef COMPILE_FLAT_SET
+template<typename K, typename C = std::less<K>, typename A = std::allocator<K> >
+using flat_set_type = boost::container::flat_set<K, C, A>;
+#		else
+template<typename K, typename C = std::less<K>, typename A = std::allocator<K> >
+using flat_set_type = boost::container::flat_multiset<K, C, A>;
+#		endif
+#	else
+#		include "flat_set.hpp"
+#		ifdef COMPILE_FLAT_SET
+template<typename K, typename C = std::less<K>, typename A = std::allocator<K> >
+using flat_set_type = flat_set<K, C, A>;
+#		else
+template<typename K, typename C = std::less<K>, typename A = std::allocator<K> >
+using flat_set_type = flat_multiset<K, C, A>;
+#		endif
+#	endif
+#	define USE_A_STRUCT(i)\
+struct CONCAT(A, i)\
+{\
+	int value;\
+	bool operator<(const CONCAT(A, i) & other) const\
+	{\
+		return value < other.value;\
+	}\
+};\
+flat_set_type<CONCAT(A, i)> CONCAT(foo, i)()\
+{\
+	flat_set_type<CONCAT(A, i)> set;\
+	set.emplace();\
+	set.erase(CONCAT(A, i)());\
+	return set;\
+}\
+flat_set_type<CONCAT(A, i)> CONCAT(static, i) = CONCAT(foo, i)()
+INSTANTIATE(NUM_ITERATIONS);
+#endif
+
+#ifdef COMPILE_STATIC_FLAT_MAP
+#	include "static_flat_map.hpp"
+// the same table as a constexpr static_flat_map. compare the build time
+// against COMPILE_FLAT_MAP: this one has no code that runs at startup
+#	define USE_A_STRUCT(i)\
+struct CONCAT(A, i)\
+{\
+	int value;\
+};\
+constexpr auto CONCAT(static, i) = make_static_flat_map<int, CONCAT(A, i)>({ { 1, { 1 } }, { 0, { 0 } } });\
+static_assert(CONCAT(static, i).at(0).value == 0, "")
+INSTANTIATE(NUM_ITERATIONS);
+#endif
+
 #include <gtest/gtest.h>
 int main(int argc, char * argv[])
 {
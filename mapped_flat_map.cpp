@@ -0,0 +1,231 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "mapped_flat_map.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace detail
+{
+namespace
+{
+[[noreturn]] void throw_errno(const std::string & message)
+{
+	throw std::system_error(errno, std::generic_category(), message);
+}
+// closes the file descriptor when it goes out of scope
+struct file_descriptor
+{
+	explicit file_descriptor(int fd)
+		: fd(fd)
+	{
+	}
+	~file_descriptor()
+	{
+		if (fd >= 0) ::close(fd);
+	}
+	int fd;
+};
+void write_all(int fd, const char * bytes, std::size_t size, const std::string & path)
+{
+	while (size)
+	{
+		ssize_t written = ::write(fd, bytes, size);
+		if (written < 0)
+		{
+			if (errno == EINTR) continue;
+			throw_errno("couldn't write " + path);
+		}
+		bytes += written;
+		size -= written;
+	}
+}
+}
+
+void write_mapped_flat_map(const char * path, const mapped_flat_map_header & header, const void * elements)
+{
+	std::string temporary = std::string(path) + ".tmp";
+	{
+		file_descriptor file(::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+		if (file.fd < 0) throw_errno("couldn't create " + temporary);
+		try
+		{
+			char header_bytes[64 * ((sizeof(mapped_flat_map_header) + 63) / 64)] = {};
+			std::memcpy(header_bytes, &header, sizeof(header));
+			write_all(file.fd, header_bytes, header.data_offset, temporary);
+			write_all(file.fd, static_cast<const char *>(elements), header.num_elements * header.element_size, temporary);
+			if (::fsync(file.fd) != 0) throw_errno("couldn't write " + temporary);
+		}
+		catch(...)
+		{
+			::unlink(temporary.c_str());
+			throw;
+		}
+	}
+	if (std::rename(temporary.c_str(), path) != 0)
+	{
+		int error = errno;
+		::unlink(temporary.c_str());
+		errno = error;
+		throw_errno("couldn't rename " + temporary + " to " + path);
+	}
+}
+
+mapped_file::mapped_file(const char * path)
+{
+	file_descriptor file(::open(path, O_RDONLY));
+	if (file.fd < 0) throw_errno(std::string("couldn't open ") + path);
+	struct stat status;
+	if (::fstat(file.fd, &status) != 0) throw_errno(std::string("couldn't stat ") + path);
+	num_bytes = status.st_size;
+	// mmap doesn't allow zero bytes. check_mapped_flat_map will complain
+	// about the missing header
+	if (num_bytes == 0) return;
+	void * mapped = ::mmap(nullptr, num_bytes, PROT_READ, MAP_SHARED, file.fd, 0);
+	if (mapped == MAP_FAILED) throw_errno(std::string("couldn't mmap ") + path);
+	bytes = static_cast<const char *>(mapped);
+}
+mapped_file::mapped_file(mapped_file && other)
+{
+	swap(other);
+}
+mapped_file & mapped_file::operator=(mapped_file && other)
+{
+	swap(other);
+	return *this;
+}
+mapped_file::~mapped_file()
+{
+	if (bytes) ::munmap(const_cast<char *>(bytes), num_bytes);
+}
+void mapped_file::swap(mapped_file & other)
+{
+	std::swap(bytes, other.bytes);
+	std::swap(num_bytes, other.num_bytes);
+}
+
+const void * check_mapped_flat_map(const mapped_file & file, const mapped_flat_map_header & expected, std::size_t & num_elements)
+{
+	if (file.size() < sizeof(mapped_flat_map_header)) throw std::runtime_error("file is too small to be a mapped_flat_map");
+	mapped_flat_map_header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) throw std::runtime_error("file is not a mapped_flat_map");
+	if (header.version != expected.version) throw std::runtime_error("mapped_flat_map file has an unsupported version");
+	if (header.byte_order != expected.byte_order) throw std::runtime_error("mapped_flat_map file was written with a different byte order");
+	if (header.key_size != expected.key_size
+		|| header.value_size != expected.value_size
+		|| header.element_size != expected.element_size
+		|| header.element_alignment != expected.element_alignment
+		|| header.value_offset != expected.value_offset)
+		throw std::runtime_error("mapped_flat_map file was written for different key or value types");
+	if (header.data_offset != expected.data_offset
+		|| (file.size() - header.data_offset) / header.element_size < header.num_elements)
+		throw std::runtime_error("mapped_flat_map file is truncated");
+	num_elements = header.num_elements;
+	return file.data() + header.data_offset;
+}
+}
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+
+namespace
+{
+std::string temporary_path(const char * name)
+{
+	return ::testing::TempDir() + name;
+}
+}
+
+TEST(mapped_flat_map, lookups)
+{
+	std::string path = temporary_path("mapped_flat_map_lookups");
+	for (int size : { 0, 1, 2, 3, 17, 100 })
+	{
+		flat_map<int, int> map;
+		for (int i = 0; i < size; ++i)
+			map.emplace(i * 2, i);
+		save_mapped_flat_map(map, path.c_str());
+		mapped_flat_map<int, int> mapped(path.c_str());
+		ASSERT_EQ(map.size(), mapped.size());
+		ASSERT_TRUE(std::equal(map.begin(), map.end(), mapped.begin()));
+		for (int i = -1; i <= size * 2; ++i)
+		{
+			ASSERT_EQ(map.lower_bound(i) - map.begin(), mapped.lower_bound(i) - mapped.begin());
+			ASSERT_EQ(map.upper_bound(i) - map.begin(), mapped.upper_bound(i) - mapped.begin());
+			ASSERT_EQ(map.find(i) - map.begin(), mapped.find(i) - mapped.begin());
+			ASSERT_EQ(map.count(i), mapped.count(i));
+			auto range = mapped.equal_range(i);
+			ASSERT_EQ(map.equal_range(i).first - map.begin(), range.first - mapped.begin());
+			ASSERT_EQ(map.equal_range(i).second - map.begin(), range.second - mapped.begin());
+		}
+	}
+	std::remove(path.c_str());
+}
+TEST(mapped_flat_map, struct_values)
+{
+	struct point
+	{
+		float x, y, z;
+	};
+	std::string path = temporary_path("mapped_flat_map_struct_values");
+	flat_map<std::uint64_t, point> map{ { 5, { 1, 2, 3 } }, { 1, { 4, 5, 6 } } };
+	save_mapped_flat_map(map, path.c_str());
+	mapped_flat_map<std::uint64_t, point> mapped(path.c_str());
+	ASSERT_EQ(3.0f, mapped.at(5).z);
+	ASSERT_EQ(4.0f, mapped.at(1).x);
+	ASSERT_THROW(mapped.at(2), std::out_of_range);
+	// the file stays mapped when the map is moved
+	mapped_flat_map<std::uint64_t, point> moved(std::move(mapped));
+	ASSERT_EQ(2u, moved.size());
+	ASSERT_EQ(6.0f, moved.at(1).z);
+	std::remove(path.c_str());
+}
+TEST(mapped_flat_map, wrong_file)
+{
+	std::string path = temporary_path("mapped_flat_map_wrong_file");
+	ASSERT_THROW((mapped_flat_map<int, int>(path.c_str())), std::system_error);
+	save_mapped_flat_map(flat_map<int, int>{ { 1, 2 } }, path.c_str());
+	ASSERT_THROW((mapped_flat_map<std::int64_t, int>(path.c_str())), std::runtime_error);
+	ASSERT_THROW((mapped_flat_map<int, double>(path.c_str())), std::runtime_error);
+	// cut off the last element
+	ASSERT_EQ(0, ::truncate(path.c_str(), detail::make_mapped_flat_map_header<int, int>(1).data_offset + sizeof(std::pair<int, int>) - 1));
+	ASSERT_THROW((mapped_flat_map<int, int>(path.c_str())), std::runtime_error);
+	ASSERT_EQ(0, ::truncate(path.c_str(), 4));
+	ASSERT_THROW((mapped_flat_map<int, int>(path.c_str())), std::runtime_error);
+	std::remove(path.c_str());
+}
+
+#endif
@@ -0,0 +1,250 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+// a file format for flat_maps of trivially copyable keys and values, and a
+// read-only map that mmaps such a file and searches it in place. opening a
+// mapped_flat_map doesn't read or copy anything, the pages are loaded when
+// a search touches them and they are shared with every other process that
+// maps the same file. the elements are stored exactly like in the vector of
+// a flat_map, so the file only works on machines with the same sizes,
+// alignment and byte order. the header records all of those and opening a
+// file that doesn't match throws an exception. the comparison function is
+// not stored, you have to use the same one that the map was sorted with
+
+namespace detail
+{
+struct mapped_flat_map_header
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint64_t key_size;
+	std::uint64_t value_size;
+	std::uint64_t element_size;
+	std::uint64_t element_alignment;
+	std::uint64_t value_offset;
+	std::uint64_t num_elements;
+	// the elements start at data_offset, which is a multiple of 64
+	std::uint64_t data_offset;
+};
+
+template<typename K, typename V>
+mapped_flat_map_header make_mapped_flat_map_header(std::uint64_t num_elements)
+{
+	typedef std::pair<K, V> value_type;
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+				  "mapped_flat_map can only store keys and values that can be copied with memcpy");
+	static_assert(alignof(value_type) <= 64, "the elements in the file are only aligned to 64 bytes");
+	mapped_flat_map_header header = {};
+	const char magic[8] = "flatmap";
+	std::copy(magic, magic + sizeof(magic), header.magic);
+	header.version = 1;
+	header.byte_order = 0x01020304;
+	header.key_size = sizeof(K);
+	header.value_size = sizeof(V);
+	header.element_size = sizeof(value_type);
+	header.element_alignment = alignof(value_type);
+	header.value_offset = offsetof(value_type, second);
+	header.num_elements = num_elements;
+	header.data_offset = (sizeof(mapped_flat_map_header) + 63) / 64 * 64;
+	return header;
+}
+
+// writes the header and the elements to a temporary file and then renames
+// it to path. so if path already exists, processes that have it mapped keep
+// the old version and processes that open it later get the new version
+void write_mapped_flat_map(const char * path, const mapped_flat_map_header & header, const void * elements);
+
+// a read-only mmap of a whole file
+struct mapped_file
+{
+	mapped_file() = default;
+	explicit mapped_file(const char * path);
+	mapped_file(mapped_file && other);
+	mapped_file & operator=(mapped_file && other);
+	~mapped_file();
+
+	const char * data() const
+	{
+		return bytes;
+	}
+	std::size_t size() const
+	{
+		return num_bytes;
+	}
+	void swap(mapped_file & other);
+
+private:
+	const char * bytes = nullptr;
+	std::size_t num_bytes = 0;
+};
+
+// checks that the file has a header that is the same as expected except
+// for num_elements, and that it is big enough for all the elements. returns
+// a pointer to the first element and stores the number of elements
+const void * check_mapped_flat_map(const mapped_file & file, const mapped_flat_map_header & expected, std::size_t & num_elements);
+}
+
+template<typename K, typename V, typename C, typename A, typename S>
+void save_mapped_flat_map(const flat_map<K, V, C, A, S> & map, const char * path)
+{
+	static_assert(detail::is_contiguous_container<typename flat_map<K, V, C, A, S>::container_type>::value, "the elements are written with one write call");
+	detail::write_mapped_flat_map(path, detail::make_mapped_flat_map_header<K, V>(map.size()), map.empty() ? nullptr : std::addressof(*map.begin()));
+}
+
+template<typename K, typename V, typename Comp = std::less<K> >
+struct mapped_flat_map
+{
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<K, V> value_type;
+	typedef Comp key_compare;
+	typedef const value_type * iterator;
+	typedef const value_type * const_iterator;
+	typedef std::reverse_iterator<const_iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef std::ptrdiff_t difference_type;
+	typedef std::size_t size_type;
+
+	mapped_flat_map() = default;
+	explicit mapped_flat_map(const char * path)
+		: file(path)
+	{
+		elements = static_cast<const value_type *>(detail::check_mapped_flat_map(file, detail::make_mapped_flat_map_header<K, V>(0), num_elements));
+	}
+	mapped_flat_map(mapped_flat_map && other)
+	{
+		swap(other);
+	}
+	mapped_flat_map & operator=(mapped_flat_map && other)
+	{
+		swap(other);
+		return *this;
+	}
+
+	const_iterator			begin()		const	{	return elements;					}
+	const_iterator			end()		const	{	return elements + num_elements;		}
+	const_iterator			cbegin()	const	{	return begin();						}
+	const_iterator			cend()		const	{	return end();						}
+	const_reverse_iterator	rbegin()	const	{	return const_reverse_iterator(end());	}
+	const_reverse_iterator	rend()		const	{	return const_reverse_iterator(begin());	}
+	const_reverse_iterator	crbegin()	const	{	return rbegin();					}
+	const_reverse_iterator	crend()		const	{	return rend();						}
+
+	bool empty() const
+	{
+		return num_elements == 0;
+	}
+	size_type size() const
+	{
+		return num_elements;
+	}
+
+	const mapped_type & at(const key_type & key) const
+	{
+		auto found = find(key);
+		if (found == end()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+	template<typename T>
+	const_iterator find(const T & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		if (lower == end() || key_compare()(key, lower->first)) return end();
+		else return lower;
+	}
+	template<typename T>
+	size_type count(const T & key) const
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+	template<typename T>
+	const_iterator lower_bound(const T & key) const
+	{
+		return begin() + lower_bound_index(key, std::integral_constant<bool, use_branchless_search<key_type, key_compare>::value
+																			&& std::is_same<T, key_type>::value>());
+	}
+	template<typename T>
+	const_iterator upper_bound(const T & key) const
+	{
+		return std::upper_bound(begin(), end(), key, [](const T & key, const value_type & element)
+		{
+			return key_compare()(key, element.first);
+		});
+	}
+	template<typename T>
+	std::pair<const_iterator, const_iterator> equal_range(const T & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		if (lower == end() || key_compare()(key, lower->first)) return { lower, lower };
+		else return { lower, lower + 1 };
+	}
+
+	key_compare key_comp() const
+	{
+		return key_compare();
+	}
+
+	void swap(mapped_flat_map & other)
+	{
+		file.swap(other.file);
+		std::swap(elements, other.elements);
+		std::swap(num_elements, other.num_elements);
+	}
+
+private:
+	detail::mapped_file file;
+	const value_type * elements = nullptr;
+	size_type num_elements = 0;
+
+	template<typename T>
+	size_type lower_bound_index(const T & key, std::false_type) const
+	{
+		return std::lower_bound(begin(), end(), key, [](const value_type & element, const T & key)
+		{
+			return key_compare()(element.first, key);
+		}) - begin();
+	}
+	size_type lower_bound_index(const key_type & key, std::true_type) const
+	{
+		if (empty()) return 0;
+		return detail::branchless_lower_bound(reinterpret_cast<const char *>(std::addressof(elements->first)), sizeof(value_type), num_elements, key);
+	}
+};
+
+template<typename K, typename V, typename C>
+void swap(mapped_flat_map<K, V, C> & lhs, mapped_flat_map<K, V, C> & rhs)
+{
+	lhs.swap(rhs);
+}
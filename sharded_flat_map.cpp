@@ -0,0 +1,130 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "sharded_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+
+TEST(sharded_flat_map, simple)
+{
+	sharded_flat_map<int, std::string> map(5);
+	ASSERT_EQ(8u, map.shard_count());
+	ASSERT_TRUE(map.empty());
+	ASSERT_TRUE(map.emplace(3, "c"));
+	ASSERT_FALSE(map.emplace(3, "x"));
+	ASSERT_TRUE(map.insert(std::make_pair(1, std::string("a"))));
+	std::vector<std::pair<int, std::string> > batch = { { 2, "b" }, { 1, "y" }, { 4, "d" } };
+	map.insert(batch.begin(), batch.end());
+	ASSERT_EQ(4u, map.size());
+	std::string found;
+	ASSERT_TRUE(map.find(1, found));
+	ASSERT_EQ("a", found);
+	ASSERT_FALSE(map.find(5, found));
+	ASSERT_TRUE(map.visit(4, [](std::string & value)
+	{
+		value += "d";
+	}));
+	ASSERT_EQ(1u, map.erase(2));
+	ASSERT_EQ(0u, map.count(2));
+	ASSERT_EQ((flat_map<int, std::string>{ { 1, "a" }, { 3, "c" }, { 4, "dd" } }), map.to_flat_map());
+	map.clear();
+	ASSERT_TRUE(map.empty());
+}
+TEST(sharded_flat_map, sorted_iteration)
+{
+	std::mt19937 randomness(5);
+	for (size_t num_shards : { 1, 2, 16 })
+	{
+		sharded_flat_map<int, int> map(num_shards);
+		std::map<int, int> expected;
+		for (int i = 0; i < 1000; ++i)
+		{
+			int key = static_cast<int>(randomness() % 2000);
+			map.emplace(key, i);
+			expected.emplace(key, i);
+		}
+		std::vector<std::pair<int, int> > visited;
+		map.for_each([&](const std::pair<int, int> & value)
+		{
+			visited.push_back(value);
+		});
+		ASSERT_EQ((std::vector<std::pair<int, int> >(expected.begin(), expected.end())), visited);
+	}
+}
+TEST(sharded_flat_map, threads)
+{
+	sharded_flat_map<int, int> map(8);
+	std::vector<std::thread> writers;
+	for (int thread = 0; thread < 4; ++thread)
+	{
+		writers.emplace_back([&map, thread]
+		{
+			for (int i = 0; i < 1000; ++i)
+			{
+				map.emplace(i * 4 + thread, thread);
+				if (i % 3 == 0)
+					map.erase((i / 2) * 4 + thread);
+				map.visit(i * 4 + thread, [](int & value)
+				{
+					++value;
+				});
+			}
+		});
+	}
+	size_t num_sorted = 0;
+	int last = -1;
+	map.for_each([&](const std::pair<int, int> & value)
+	{
+		EXPECT_LT(last, value.first);
+		last = value.first;
+		++num_sorted;
+	});
+	for (std::thread & writer : writers)
+		writer.join();
+	sharded_flat_map<int, int> expected(1);
+	for (int thread = 0; thread < 4; ++thread)
+	{
+		for (int i = 0; i < 1000; ++i)
+		{
+			expected.emplace(i * 4 + thread, thread);
+			if (i % 3 == 0)
+				expected.erase((i / 2) * 4 + thread);
+			expected.visit(i * 4 + thread, [](int & value)
+			{
+				++value;
+			});
+		}
+	}
+	ASSERT_EQ(expected.to_flat_map(), map.to_flat_map());
+}
+
+#endif
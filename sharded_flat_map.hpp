@@ -0,0 +1,265 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// a flat_map for many writer threads: the keys are split by hash into
+// several flat_maps, the shards, each with its own mutex and on its own
+// cache lines. threads that write to different shards don't wait for each
+// other and every insert only shifts the elements of one shard.
+//
+// the functions lock one shard and don't hand out iterators or references,
+// because those would be unprotected once the lock is gone. visit() calls a
+// function with the value while the lock is held. iterating in key order
+// locks all shards and merges them, see for_each
+template<typename K, typename V, typename Comp = std::less<K>, typename Hash = std::hash<K>, typename AllocatorOrContainer = std::allocator<std::pair<K, V> >, typename Search = adaptive_search>
+struct sharded_flat_map
+{
+	typedef flat_map<K, V, Comp, AllocatorOrContainer, Search> map_type;
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<K, V> value_type;
+	typedef size_t size_type;
+
+	// the number of shards gets rounded up to a power of two. a few times
+	// the number of writer threads is a good start
+	explicit sharded_flat_map(size_t num_shards = 16)
+	{
+		shard_bits = 0;
+		while ((size_t(1) << shard_bits) < num_shards)
+			++shard_bits;
+		this->num_shards = size_t(1) << shard_bits;
+		// new doesn't align to cache lines before C++17, so align by hand
+		storage.reset(new char[this->num_shards * shard_stride + cache_line - 1]);
+		std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage.get());
+		shards = reinterpret_cast<char *>((address + cache_line - 1) / cache_line * cache_line);
+		for (size_t i = 0; i < this->num_shards; ++i)
+			new (shards + i * shard_stride) shard();
+	}
+	sharded_flat_map(const sharded_flat_map &) = delete;
+	sharded_flat_map & operator=(const sharded_flat_map &) = delete;
+	~sharded_flat_map()
+	{
+		for (size_t i = 0; i < num_shards; ++i)
+			shard_at(i).~shard();
+	}
+
+	template<typename... Args>
+	bool emplace(const key_type & key, Args &&... args)
+	{
+		shard & s = shard_for(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.emplace(key, std::forward<Args>(args)...).second;
+	}
+	bool insert(const value_type & value)
+	{
+		return emplace(value.first, value.second);
+	}
+	bool insert(value_type && value)
+	{
+		shard & s = shard_for(value.first);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.insert(std::move(value)).second;
+	}
+	// sorts the batch into the shards first, then locks every shard once
+	// and uses the batch insert of flat_map
+	template<typename It>
+	void insert(It first, It last)
+	{
+		std::vector<std::vector<value_type> > per_shard(num_shards);
+		for (; first != last; ++first)
+			per_shard[shard_index(first->first)].push_back(*first);
+		for (size_t i = 0; i < num_shards; ++i)
+		{
+			if (per_shard[i].empty()) continue;
+			shard & s = shard_at(i);
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.map.insert(std::make_move_iterator(per_shard[i].begin()), std::make_move_iterator(per_shard[i].end()));
+		}
+	}
+	size_type erase(const key_type & key)
+	{
+		shard & s = shard_for(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.erase(key);
+	}
+
+	// copies the value into result if the key exists
+	bool find(const key_type & key, mapped_type & result) const
+	{
+		const shard & s = shard_for(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		auto found = s.map.find(key);
+		if (found == s.map.end()) return false;
+		result = found->second;
+		return true;
+	}
+	size_type count(const key_type & key) const
+	{
+		const shard & s = shard_for(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		return s.map.count(key);
+	}
+	// calls func(mapped_type &) if the key exists, while holding the lock of
+	// its shard. func must not call back into this map
+	template<typename Func>
+	bool visit(const key_type & key, Func && func)
+	{
+		shard & s = shard_for(key);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		auto found = s.map.find(key);
+		if (found == s.map.end()) return false;
+		func(found->second);
+		return true;
+	}
+
+	// these lock every shard, one after the other. so with concurrent
+	// writes the result doesn't have to match any single point in time
+	size_type size() const
+	{
+		size_type result = 0;
+		for (size_t i = 0; i < num_shards; ++i)
+		{
+			const shard & s = shard_at(i);
+			std::lock_guard<std::mutex> lock(s.mutex);
+			result += s.map.size();
+		}
+		return result;
+	}
+	bool empty() const
+	{
+		return size() == 0;
+	}
+	void clear()
+	{
+		for (size_t i = 0; i < num_shards; ++i)
+		{
+			shard & s = shard_at(i);
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.map.clear();
+		}
+	}
+
+	// calls func(const value_type &) for all elements in key order. this
+	// locks all shards at once, in index order so that two calls can't
+	// deadlock, and does a k-way merge of them with a heap. O(n log(k)).
+	// the result is a consistent snapshot. func must not call back into
+	// this map
+	template<typename Func>
+	void for_each(Func && func) const
+	{
+		std::vector<std::unique_lock<std::mutex> > locks;
+		locks.reserve(num_shards);
+		typedef typename map_type::const_iterator iterator;
+		std::vector<std::pair<iterator, iterator> > heap;
+		heap.reserve(num_shards);
+		for (size_t i = 0; i < num_shards; ++i)
+		{
+			const shard & s = shard_at(i);
+			locks.emplace_back(s.mutex);
+			if (!s.map.empty())
+				heap.emplace_back(s.map.begin(), s.map.end());
+		}
+		// std heaps have the biggest element at the front
+		auto greater = [](const std::pair<iterator, iterator> & lhs, const std::pair<iterator, iterator> & rhs)
+		{
+			return Comp()(rhs.first->first, lhs.first->first);
+		};
+		std::make_heap(heap.begin(), heap.end(), greater);
+		while (!heap.empty())
+		{
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			func(*heap.back().first);
+			if (++heap.back().first == heap.back().second)
+				heap.pop_back();
+			else
+				std::push_heap(heap.begin(), heap.end(), greater);
+		}
+	}
+	// a copy of all elements as one flat_map, using for_each
+	map_type to_flat_map() const
+	{
+		typename map_type::container_type sorted;
+		for_each([&sorted](const value_type & value)
+		{
+			sorted.push_back(value);
+		});
+		return map_type(sorted_unique, std::move(sorted));
+	}
+
+	size_t shard_count() const
+	{
+		return num_shards;
+	}
+
+private:
+	struct shard
+	{
+		mutable std::mutex mutex;
+		map_type map;
+	};
+	static constexpr size_t cache_line = 64;
+	static constexpr size_t shard_stride = (sizeof(shard) + cache_line - 1) / cache_line * cache_line;
+
+	std::unique_ptr<char[]> storage;
+	char * shards;
+	size_t num_shards;
+	unsigned shard_bits;
+
+	shard & shard_at(size_t index)
+	{
+		return *reinterpret_cast<shard *>(shards + index * shard_stride);
+	}
+	const shard & shard_at(size_t index) const
+	{
+		return *reinterpret_cast<const shard *>(shards + index * shard_stride);
+	}
+	// multiplies the hash by 2^64 / phi and takes the top bits, because
+	// std::hash of an integer is often the integer itself
+	size_t shard_index(const key_type & key) const
+	{
+		if (shard_bits == 0) return 0;
+		std::uint64_t hash = static_cast<std::uint64_t>(Hash()(key));
+		return static_cast<size_t>((hash * 0x9e3779b97f4a7c15ull) >> (64 - shard_bits));
+	}
+	shard & shard_for(const key_type & key)
+	{
+		return shard_at(shard_index(key));
+	}
+	const shard & shard_for(const key_type & key) const
+	{
+		return shard_at(shard_index(key));
+	}
+};
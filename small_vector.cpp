@@ -0,0 +1,112 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "small_vector.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+TEST(small_vector, grow)
+{
+	small_vector<std::string, 2> vector;
+	vector.emplace_back("a");
+	vector.push_back("b");
+	ASSERT_TRUE(vector.is_inline());
+	ASSERT_EQ(2u, vector.capacity());
+	vector.emplace_back(vector.front());
+	ASSERT_FALSE(vector.is_inline());
+	ASSERT_EQ((small_vector<std::string, 2>{ "a", "b", "a" }), vector);
+	vector.pop_back();
+	vector.shrink_to_fit();
+	ASSERT_TRUE(vector.is_inline());
+	ASSERT_EQ((small_vector<std::string, 2>{ "a", "b" }), vector);
+}
+TEST(small_vector, emplace_and_erase)
+{
+	small_vector<std::string, 4> vector{ "a", "c" };
+	vector.emplace(vector.begin() + 1, "b");
+	vector.emplace(vector.begin(), "0");
+	vector.emplace(vector.end(), "d");
+	vector.insert(vector.begin() + 2, vector[4]);
+	ASSERT_EQ((small_vector<std::string, 4>{ "0", "a", "d", "b", "c", "d" }), vector);
+	vector.erase(vector.begin() + 2);
+	ASSERT_EQ((small_vector<std::string, 4>{ "0", "a", "b", "c", "d" }), vector);
+	vector.erase(vector.begin(), vector.begin() + 2);
+	ASSERT_EQ((small_vector<std::string, 4>{ "b", "c", "d" }), vector);
+}
+TEST(small_vector, move_and_swap)
+{
+	small_vector<std::string, 2> small{ "a" };
+	small_vector<std::string, 2> big{ "b", "c", "d" };
+	const std::string * big_data = big.data();
+	small.swap(big);
+	ASSERT_EQ((small_vector<std::string, 2>{ "b", "c", "d" }), small);
+	ASSERT_EQ((small_vector<std::string, 2>{ "a" }), big);
+	// moving from the heap keeps the same storage
+	ASSERT_EQ(big_data, small.data());
+	small_vector<std::string, 2> moved(std::move(big));
+	ASSERT_TRUE(big.empty());
+	ASSERT_EQ("a", moved.front());
+	moved = small;
+	ASSERT_EQ(small, moved);
+	ASSERT_NE(small.data(), moved.data());
+}
+TEST(small_vector, flat_map)
+{
+	typedef flat_map<int, int, std::less<int>, small_vector<std::pair<int, int>, 8> > small_map;
+	std::mt19937 randomness(5);
+	for (int size : { 0, 1, 7, 8, 9, 100 })
+	{
+		small_map small;
+		flat_map<int, int> normal;
+		for (int i = 0; i < size; ++i)
+		{
+			int key = randomness() % 200;
+			small.emplace(key, i);
+			normal.emplace(key, i);
+		}
+		std::vector<std::pair<int, int> > batch{ { 5, 1 }, { 500, 2 }, { 3, 3 } };
+		small.insert(batch.begin(), batch.end());
+		normal.insert(batch.begin(), batch.end());
+		ASSERT_TRUE(std::equal(normal.begin(), normal.end(), small.begin(), small.end()));
+		for (int i = -1; i <= 201; ++i)
+		{
+			ASSERT_EQ(normal.lower_bound(i) - normal.begin(), small.lower_bound(i) - small.begin());
+			ASSERT_EQ(normal.count(i), small.count(i));
+		}
+		small.erase(500);
+		ASSERT_EQ(normal.size() - 1, small.size());
+	}
+	small_map map{ { 1, 2 }, { 3, 4 } };
+	ASSERT_EQ(4, map[3]);
+	ASSERT_EQ(0, map[2]);
+	ASSERT_EQ((std::vector<int>{ 1, 2, 3 }), (std::vector<int>{ map.begin()->first, (map.begin() + 1)->first, (map.begin() + 2)->first }));
+}
+
+#endif
@@ -0,0 +1,402 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "flat_map.hpp"
+
+// a vector that keeps the first N elements inside of itself and only
+// allocates once it grows bigger than that. meant as the container of a
+// flat_map that usually holds only a few elements:
+// flat_map<K, V, std::less<K>, small_vector<std::pair<K, V>, 8> >
+// moving a small_vector that is still using its inline storage has to move
+// every element, and swap is three moves, so this is only worth it for
+// small N. the allocator is copied along with the elements on copy, move
+// and swap
+template<typename T, size_t N, typename Allocator = std::allocator<T> >
+struct small_vector
+{
+	static_assert(N > 0, "use std::vector if you don't want inline storage");
+
+	typedef T value_type;
+	typedef Allocator allocator_type;
+	typedef std::allocator_traits<allocator_type> allocator_traits;
+	typedef T & reference;
+	typedef const T & const_reference;
+	typedef T * pointer;
+	typedef const T * const_pointer;
+	typedef T * iterator;
+	typedef const T * const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef std::ptrdiff_t difference_type;
+	typedef std::size_t size_type;
+
+	small_vector() = default;
+	explicit small_vector(const allocator_type & allocator)
+		: allocator(allocator)
+	{
+	}
+	template<typename It, typename = typename std::iterator_traits<It>::iterator_category>
+	small_vector(It begin, It end, const allocator_type & allocator = allocator_type())
+		: allocator(allocator)
+	{
+		for (; begin != end; ++begin)
+			emplace_back(*begin);
+	}
+	small_vector(std::initializer_list<T> il, const allocator_type & allocator = allocator_type())
+		: small_vector(il.begin(), il.end(), allocator)
+	{
+	}
+	small_vector(const small_vector & other)
+		: small_vector(other.begin(), other.end(), allocator_traits::select_on_container_copy_construction(other.allocator))
+	{
+	}
+	small_vector(small_vector && other)
+		: allocator(other.allocator)
+	{
+		steal(other);
+	}
+	small_vector & operator=(const small_vector & other)
+	{
+		if (this != &other)
+		{
+			small_vector copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	small_vector & operator=(small_vector && other)
+	{
+		if (this != &other)
+		{
+			clear();
+			deallocate();
+			allocator = other.allocator;
+			steal(other);
+		}
+		return *this;
+	}
+	~small_vector()
+	{
+		clear();
+		deallocate();
+	}
+
+	iterator				begin()				{	return first;		}
+	iterator				end()				{	return last;		}
+	const_iterator			begin()		const	{	return first;		}
+	const_iterator			end()		const	{	return last;		}
+	const_iterator			cbegin()	const	{	return first;		}
+	const_iterator			cend()		const	{	return last;		}
+	reverse_iterator		rbegin()			{	return reverse_iterator(end());			}
+	reverse_iterator		rend()				{	return reverse_iterator(begin());		}
+	const_reverse_iterator	rbegin()	const	{	return const_reverse_iterator(end());	}
+	const_reverse_iterator	rend()		const	{	return const_reverse_iterator(begin());	}
+	const_reverse_iterator	crbegin()	const	{	return rbegin();	}
+	const_reverse_iterator	crend()		const	{	return rend();		}
+
+	T * data()
+	{
+		return first;
+	}
+	const T * data() const
+	{
+		return first;
+	}
+	T & operator[](size_type index)
+	{
+		return first[index];
+	}
+	const T & operator[](size_type index) const
+	{
+		return first[index];
+	}
+	T & front()
+	{
+		return *first;
+	}
+	const T & front() const
+	{
+		return *first;
+	}
+	T & back()
+	{
+		return last[-1];
+	}
+	const T & back() const
+	{
+		return last[-1];
+	}
+
+	bool empty() const
+	{
+		return first == last;
+	}
+	size_type size() const
+	{
+		return last - first;
+	}
+	size_type max_size() const
+	{
+		return allocator_traits::max_size(allocator);
+	}
+	size_type capacity() const
+	{
+		return capacity_end - first;
+	}
+	// true while the elements are in the inline storage
+	bool is_inline() const
+	{
+		return first == inline_begin();
+	}
+	void reserve(size_type new_capacity)
+	{
+		if (new_capacity > capacity()) reallocate(new_capacity);
+	}
+	void shrink_to_fit()
+	{
+		if (is_inline() || size() == capacity()) return;
+		if (size() <= N)
+		{
+			size_type num_elements = size();
+			move_elements(first, last, inline_begin());
+			clear();
+			deallocate();
+			last = first + num_elements;
+		}
+		else reallocate(size());
+	}
+	allocator_type get_allocator() const
+	{
+		return allocator;
+	}
+
+	template<typename... Args>
+	T & emplace_back(Args &&... args)
+	{
+		if (last == capacity_end)
+		{
+			// construct first in case args refers to an element
+			T value(std::forward<Args>(args)...);
+			reallocate(grown_capacity());
+			allocator_traits::construct(allocator, last, std::move(value));
+		}
+		else allocator_traits::construct(allocator, last, std::forward<Args>(args)...);
+		return *last++;
+	}
+	void push_back(const T & value)
+	{
+		emplace_back(value);
+	}
+	void push_back(T && value)
+	{
+		emplace_back(std::move(value));
+	}
+	void pop_back()
+	{
+		allocator_traits::destroy(allocator, --last);
+	}
+	template<typename... Args>
+	iterator emplace(const_iterator position, Args &&... args)
+	{
+		size_type index = position - first;
+		if (position == last)
+		{
+			emplace_back(std::forward<Args>(args)...);
+			return first + index;
+		}
+		T value(std::forward<Args>(args)...);
+		emplace_back(std::move(back()));
+		iterator it = first + index;
+		std::move_backward(it, last - 2, last - 1);
+		*it = std::move(value);
+		return it;
+	}
+	iterator insert(const_iterator position, const T & value)
+	{
+		return emplace(position, value);
+	}
+	iterator insert(const_iterator position, T && value)
+	{
+		return emplace(position, std::move(value));
+	}
+	iterator erase(const_iterator position)
+	{
+		return erase(position, position + 1);
+	}
+	iterator erase(const_iterator begin, const_iterator end)
+	{
+		iterator it = first + (begin - first);
+		iterator new_last = std::move(it + (end - begin), last, it);
+		destroy(new_last, last);
+		last = new_last;
+		return it;
+	}
+	void clear()
+	{
+		destroy(first, last);
+		last = first;
+	}
+	void swap(small_vector & other)
+	{
+		small_vector temporary(std::move(other));
+		other = std::move(*this);
+		*this = std::move(temporary);
+	}
+
+	bool operator==(const small_vector & other) const
+	{
+		return size() == other.size() && std::equal(begin(), end(), other.begin());
+	}
+	bool operator!=(const small_vector & other) const
+	{
+		return !(*this == other);
+	}
+	bool operator<(const small_vector & other) const
+	{
+		return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+	}
+	bool operator>(const small_vector & other) const
+	{
+		return other < *this;
+	}
+	bool operator<=(const small_vector & other) const
+	{
+		return !(other < *this);
+	}
+	bool operator>=(const small_vector & other) const
+	{
+		return !(*this < other);
+	}
+
+private:
+	typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type storage;
+	allocator_type allocator;
+	T * first = inline_begin();
+	T * last = first;
+	T * capacity_end = first + N;
+
+	T * inline_begin()
+	{
+		return reinterpret_cast<T *>(&storage);
+	}
+	const T * inline_begin() const
+	{
+		return reinterpret_cast<const T *>(&storage);
+	}
+	size_type grown_capacity() const
+	{
+		return capacity() * 2;
+	}
+	void destroy(T * begin, T * end)
+	{
+		for (; begin != end; ++begin)
+			allocator_traits::destroy(allocator, begin);
+	}
+	// move constructs into uninitialized memory at out. if a move throws,
+	// destroys what it already constructed and rethrows
+	void move_elements(T * begin, T * end, T * out)
+	{
+		T * constructed = out;
+		try
+		{
+			for (; begin != end; ++begin, ++constructed)
+				allocator_traits::construct(allocator, constructed, std::move_if_noexcept(*begin));
+		}
+		catch(...)
+		{
+			destroy(out, constructed);
+			throw;
+		}
+	}
+	void reallocate(size_type new_capacity)
+	{
+		T * heap = allocator_traits::allocate(allocator, new_capacity);
+		size_type num_elements = size();
+		try
+		{
+			move_elements(first, last, heap);
+		}
+		catch(...)
+		{
+			allocator_traits::deallocate(allocator, heap, new_capacity);
+			throw;
+		}
+		clear();
+		deallocate();
+		first = heap;
+		last = heap + num_elements;
+		capacity_end = heap + new_capacity;
+	}
+	void deallocate()
+	{
+		if (!is_inline())
+			allocator_traits::deallocate(allocator, first, capacity());
+		first = last = inline_begin();
+		capacity_end = first + N;
+	}
+	// takes the elements of other. this has to be empty and other is left
+	// empty. only moves the elements if other uses the inline storage
+	void steal(small_vector & other)
+	{
+		if (other.is_inline())
+		{
+			move_elements(other.first, other.last, first);
+			last = first + other.size();
+			other.clear();
+		}
+		else
+		{
+			first = other.first;
+			last = other.last;
+			capacity_end = other.capacity_end;
+			other.first = other.last = other.inline_begin();
+			other.capacity_end = other.first + N;
+		}
+	}
+};
+
+template<typename T, size_t N, typename A>
+void swap(small_vector<T, N, A> & lhs, small_vector<T, N, A> & rhs)
+{
+	lhs.swap(rhs);
+}
+
+namespace detail
+{
+template<typename T, size_t N, typename Allocator>
+struct is_contiguous_container<small_vector<T, N, Allocator> > : std::true_type
+{
+};
+}
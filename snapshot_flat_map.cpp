@@ -0,0 +1,130 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "snapshot_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+TEST(snapshot_flat_map, snapshots)
+{
+	snapshot_flat_map<int, std::string> map(flat_map<int, std::string>{ { 1, "a" }, { 2, "b" } });
+	auto reader = map.make_reader();
+	{
+		auto before = reader.read();
+		std::vector<std::pair<int, std::string> > batch = { { 3, "c" }, { 1, "x" } };
+		map.insert(batch.begin(), batch.end());
+		// the old snapshot doesn't change, a new one sees the insert
+		ASSERT_EQ((flat_map<int, std::string>{ { 1, "a" }, { 2, "b" } }), *before);
+		auto after = reader.read();
+		ASSERT_EQ((flat_map<int, std::string>{ { 1, "a" }, { 2, "b" }, { 3, "c" } }), *after);
+		// the first version is still held
+		ASSERT_EQ(1u, map.collect());
+	}
+	ASSERT_EQ(0u, map.collect());
+	map.update([](flat_map<int, std::string> & map)
+	{
+		map.erase(2);
+		map[4] = "d";
+	});
+	ASSERT_EQ((flat_map<int, std::string>{ { 1, "a" }, { 3, "c" }, { 4, "d" } }), *reader.read());
+	map.replace(flat_map<int, std::string>{ { 5, "e" } });
+	ASSERT_EQ("e", reader.read()->at(5));
+	ASSERT_EQ(0u, map.collect());
+}
+TEST(snapshot_flat_map, readers)
+{
+	snapshot_flat_map<int, int> map(flat_map<int, int>(), 2);
+	auto first = map.make_reader();
+	{
+		auto second = map.make_reader();
+		ASSERT_THROW(map.make_reader(), std::runtime_error);
+	}
+	// the slot of a destroyed reader can be used again
+	auto third = map.make_reader();
+	{
+		auto snapshot = third.read();
+		map.replace(flat_map<int, int>{ { 1, 1 } });
+		map.replace(flat_map<int, int>{ { 2, 2 } });
+		ASSERT_EQ(2u, map.collect());
+		ASSERT_TRUE(snapshot->empty());
+	}
+	// first never read, so it doesn't hold anything back
+	ASSERT_EQ(0u, map.collect());
+	ASSERT_EQ(1u, third.read()->count(2));
+}
+// every version has the same value for all keys, so a reader that sees
+// two different values saw a torn or freed version
+TEST(snapshot_flat_map, threads)
+{
+	const int num_keys = 100;
+	auto make_version = [&](int value)
+	{
+		flat_map<int, int> result;
+		for (int i = 0; i < num_keys; ++i)
+			result.emplace(i, value);
+		return result;
+	};
+	snapshot_flat_map<int, int> map(make_version(0));
+	std::atomic<bool> done{false};
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&]
+		{
+			auto reader = map.make_reader();
+			int last_seen = 0;
+			while (!done.load())
+			{
+				auto snapshot = reader.read();
+				int value = snapshot->begin()->second;
+				// versions only go forward
+				EXPECT_LE(last_seen, value);
+				last_seen = value;
+				for (const auto & element : *snapshot)
+					EXPECT_EQ(value, element.second);
+			}
+		});
+	}
+	for (int version = 1; version <= 200; ++version)
+	{
+		map.update([&](flat_map<int, int> & map)
+		{
+			for (auto & element : map)
+				element.second = version;
+		});
+	}
+	done = true;
+	for (std::thread & reader : readers)
+		reader.join();
+	ASSERT_EQ(0u, map.collect());
+	ASSERT_EQ(200, map.make_reader().read()->at(5));
+}
+
+#endif
@@ -0,0 +1,276 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// a flat_map for many reader threads and a few writes per second. readers
+// never lock: they take a snapshot, which is an immutable version of the
+// map that stays valid for as long as they hold it. writers copy the current
+// version, change the copy, for example with a batch insert, and publish it.
+// a reader that takes a snapshot after that sees the new version.
+//
+// old versions are freed with epoch based reclamation. every reader has its
+// own slot on its own cache line, and while it holds a snapshot the slot
+// contains the epoch in which the snapshot was taken. publishing a version
+// increments the epoch, and an old version can be freed once no slot has an
+// epoch from before the version was replaced. so taking a snapshot is two
+// stores and two loads, none of them to memory that other readers write to.
+// compare that to a shared_mutex where every reader writes to the lock.
+//
+// usage:
+// snapshot_flat_map<int, int> map;
+// // once for every reader thread
+// auto reader = map.make_reader();
+// // then for every lookup, or every group of lookups
+// auto snapshot = reader.read();
+// auto found = snapshot->find(5);
+//
+// a reader is for one thread at a time. it can hold several snapshots at
+// once, for example in nested functions, but it can't be moved while it
+// holds any. as long as it holds one, it holds back the freeing of every
+// version that was replaced since the first one was taken. the map has to outlive its readers. writers lock a mutex, so there is no point in having many
+template<typename K, typename V, typename Comp = std::less<K>, typename AllocatorOrContainer = std::allocator<std::pair<K, V> >, typename Search = adaptive_search>
+struct snapshot_flat_map
+{
+	typedef flat_map<K, V, Comp, AllocatorOrContainer, Search> map_type;
+
+private:
+	// padded so that readers don't share cache lines. the epoch is zero
+	// if the reader doesn't hold a snapshot
+	struct reader_slot
+	{
+		std::atomic<std::uint64_t> epoch{0};
+		std::atomic<bool> in_use{false};
+		char padding[64 - sizeof(std::atomic<std::uint64_t>) - sizeof(std::atomic<bool>)];
+	};
+	static_assert(sizeof(reader_slot) == 64, "a reader slot should be one cache line");
+
+public:
+	struct reader;
+	// a version of the map. it doesn't change while you hold it and the
+	// memory stays valid until the snapshot is destroyed
+	struct snapshot
+	{
+		snapshot(snapshot && other)
+			: owner(other.owner), map(other.map)
+		{
+			other.owner = nullptr;
+		}
+		snapshot & operator=(snapshot && other)
+		{
+			std::swap(owner, other.owner);
+			std::swap(map, other.map);
+			return *this;
+		}
+		~snapshot()
+		{
+			if (owner) owner->unpin();
+		}
+
+		const map_type & operator*() const
+		{
+			return *map;
+		}
+		const map_type * operator->() const
+		{
+			return map;
+		}
+
+	private:
+		friend struct reader;
+		snapshot(reader * owner, const map_type * map)
+			: owner(owner), map(map)
+		{
+		}
+
+		reader * owner;
+		const map_type * map;
+	};
+	struct reader
+	{
+		reader(reader && other)
+			: slot(other.slot), owner(other.owner), num_pinned(other.num_pinned)
+		{
+			other.slot = nullptr;
+		}
+		reader & operator=(reader && other)
+		{
+			std::swap(slot, other.slot);
+			std::swap(owner, other.owner);
+			std::swap(num_pinned, other.num_pinned);
+			return *this;
+		}
+		~reader()
+		{
+			if (slot) slot->in_use.store(false, std::memory_order_release);
+		}
+
+		// wait free. the epoch has to be visible to writers before the map
+		// pointer gets loaded, which is why these are sequentially consistent.
+		// a newer version that a nested snapshot sees is protected by the
+		// epoch that is already in the slot: it can't be replaced before
+		// that epoch, so it can't be freed before the slot is cleared
+		snapshot read()
+		{
+			if (num_pinned++ == 0)
+				slot->epoch.store(owner->epoch.load());
+			return snapshot(this, owner->current.load());
+		}
+
+	private:
+		friend struct snapshot_flat_map;
+		reader(reader_slot * slot, const snapshot_flat_map * owner)
+			: slot(slot), owner(owner)
+		{
+		}
+		void unpin()
+		{
+			if (--num_pinned == 0)
+				slot->epoch.store(0, std::memory_order_release);
+		}
+		friend struct snapshot;
+
+		reader_slot * slot;
+		const snapshot_flat_map * owner;
+		size_t num_pinned = 0;
+	};
+
+	// the slots for the readers are allocated up front, make_reader throws
+	// if all of them are in use
+	explicit snapshot_flat_map(map_type initial = map_type(), size_t max_readers = 64)
+		: current(new map_type(std::move(initial))), slots(new reader_slot[max_readers]), max_readers(max_readers)
+	{
+	}
+	snapshot_flat_map(const snapshot_flat_map &) = delete;
+	snapshot_flat_map & operator=(const snapshot_flat_map &) = delete;
+	~snapshot_flat_map()
+	{
+		delete current.load();
+	}
+
+	reader make_reader()
+	{
+		for (size_t i = 0; i < max_readers; ++i)
+		{
+			bool expected = false;
+			if (!slots[i].in_use.load(std::memory_order_relaxed) && slots[i].in_use.compare_exchange_strong(expected, true))
+				return reader(&slots[i], this);
+		}
+		throw std::runtime_error("snapshot_flat_map: all reader slots are in use");
+	}
+
+	// the write functions each publish one new version. they copy the whole
+	// map, so put as many changes as possible into one call
+
+	// uses the batch insert of flat_map, so keys that are already in the
+	// map keep their old values
+	template<typename It>
+	void insert(It first, It last)
+	{
+		update([&](map_type & map)
+		{
+			map.insert(first, last);
+		});
+	}
+	template<typename It, typename Combine>
+	void merge_updates(It first, It last, Combine combine)
+	{
+		update([&](map_type & map)
+		{
+			map.merge_updates(first, last, std::move(combine));
+		});
+	}
+	// calls func with a copy of the current version, then publishes the copy
+	template<typename Func>
+	void update(Func && func)
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		std::unique_ptr<map_type> copy(new map_type(*current.load(std::memory_order_relaxed)));
+		func(*copy);
+		publish(std::move(copy));
+	}
+	void replace(map_type map)
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		publish(std::unique_ptr<map_type>(new map_type(std::move(map))));
+	}
+
+	// frees the old versions that no reader can see anymore. publishing a
+	// new version does this too, so you only have to call this if you want
+	// the memory back before the next write. returns the number of old
+	// versions that readers still hold
+	size_t collect()
+	{
+		std::lock_guard<std::mutex> lock(write_mutex);
+		return collect_locked();
+	}
+
+private:
+	std::atomic<const map_type *> current;
+	// starts at one because zero means that a reader is not reading
+	std::atomic<std::uint64_t> epoch{1};
+	std::unique_ptr<reader_slot[]> slots;
+	size_t max_readers;
+	std::mutex write_mutex;
+	// the versions that were replaced, with the epoch in which they were
+	// replaced. only touched while holding the write_mutex
+	std::vector<std::pair<std::uint64_t, std::unique_ptr<const map_type> > > retired;
+
+	void publish(std::unique_ptr<map_type> map)
+	{
+		std::unique_ptr<const map_type> old(current.exchange(map.release()));
+		// a reader that announces this epoch or a later one loads the new
+		// pointer, so the old one is safe once all slots are at least here
+		std::uint64_t replaced_in = epoch.fetch_add(1) + 1;
+		retired.emplace_back(replaced_in, std::move(old));
+		collect_locked();
+	}
+	size_t collect_locked()
+	{
+		std::uint64_t oldest = epoch.load();
+		for (size_t i = 0; i < max_readers; ++i)
+		{
+			std::uint64_t reading = slots[i].epoch.load();
+			if (reading != 0 && reading < oldest)
+				oldest = reading;
+		}
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [oldest](const std::pair<std::uint64_t, std::unique_ptr<const map_type> > & version)
+		{
+			return version.first <= oldest;
+		}), retired.end());
+		return retired.size();
+	}
+};
@@ -0,0 +1,115 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "soa_flat_map.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+TEST(soa_flat_map, initalizer_list)
+{
+	soa_flat_map<int, int> foo = { { 5, 7 }, { 4, 3 } };
+	ASSERT_EQ(7, foo[5]);
+	ASSERT_EQ(3, foo[4]);
+	ASSERT_EQ(7, foo.at(5));
+	ASSERT_EQ(3, foo.at(4));
+	ASSERT_THROW(foo.at(3), std::out_of_range);
+	ASSERT_EQ(0, foo[3]);
+	ASSERT_EQ((std::vector<int>{ 3, 4, 5 }), foo.keys());
+	ASSERT_EQ((std::vector<int>{ 0, 3, 7 }), foo.values());
+	ASSERT_EQ((soa_flat_map<int, int>{ { 5, 7 } }), (soa_flat_map<int, int>{ { 5, 7 }, { 5, 8 } }));
+}
+TEST(soa_flat_map, insert)
+{
+	soa_flat_map<int, int> foo;
+	foo.insert(std::make_pair(5, 4));
+	foo.insert(foo.begin(), std::make_pair(3, 4));
+	foo.insert(foo.begin(), std::make_pair(3, 5));
+	ASSERT_EQ((soa_flat_map<int, int>{ { 5, 4 }, { 3, 4 } }), foo);
+	std::vector<std::pair<int, int> > bar{ { 6, 7 }, { 8, 7 }, { 1, 7 }, { 8, 8 }, { 5, 5 } };
+	foo.insert(bar.begin(), bar.end());
+	ASSERT_EQ((soa_flat_map<int, int>{ { 5, 4 }, { 3, 4 }, { 6, 7 }, { 1, 7 }, { 8, 7 } }), foo);
+	foo.emplace(0, 0);
+	foo.insert(foo.lower_bound(4), std::make_pair(4, 9));
+	ASSERT_EQ((soa_flat_map<int, int>{ { 4, 9 }, { 0, 0 }, { 5, 4 }, { 3, 4 }, { 6, 7 }, { 1, 7 }, { 8, 7 } }), foo);
+}
+TEST(soa_flat_map, erase)
+{
+	soa_flat_map<int, std::string> foo{ { 1, "a" }, { 3, "b" }, { 5, "c" }, { 7, "d" } };
+	foo.erase(foo.begin());
+	ASSERT_EQ((soa_flat_map<int, std::string>{ { 3, "b" }, { 5, "c" }, { 7, "d" } }), foo);
+	foo.erase(4);
+	foo.erase(5);
+	ASSERT_EQ((soa_flat_map<int, std::string>{ { 3, "b" }, { 7, "d" } }), foo);
+	foo.erase(foo.begin(), foo.end());
+	ASSERT_TRUE(foo.empty());
+}
+TEST(soa_flat_map, iterators)
+{
+	soa_flat_map<std::string, int> foo{ { "b", 2 }, { "a", 1 }, { "c", 3 } };
+	std::string keys;
+	for (const auto & kv : foo)
+		keys += kv.first;
+	ASSERT_EQ("abc", keys);
+	for (auto && kv : foo)
+		kv.second *= 10;
+	ASSERT_EQ(20, foo.find("b")->second);
+	foo.find("c")->second = 5;
+	ASSERT_EQ(5, foo["c"]);
+	ASSERT_EQ("c", foo.rbegin()->first);
+	soa_flat_map<std::string, int>::const_iterator it = foo.begin();
+	ASSERT_EQ(it, foo.cbegin());
+	ASSERT_EQ(3, foo.cend() - it);
+	ASSERT_EQ("b", it[1].first);
+	ASSERT_EQ(foo.end(), foo.find("d"));
+	ASSERT_EQ(foo.begin() + 1, foo.lower_bound("b"));
+	ASSERT_EQ(foo.begin() + 2, foo.upper_bound("b"));
+}
+TEST(soa_flat_map, search)
+{
+	soa_flat_map<std::int64_t, int> map;
+	for (int i = 0; i < 100; ++i)
+		map.emplace(i * 2, i);
+	for (int i = -1; i < 201; ++i)
+	{
+		ASSERT_EQ(i < 0 ? 0 : (i + 1) / 2, map.lower_bound(i) - map.begin());
+		ASSERT_EQ(i >= 0 && i < 200 && i % 2 == 0 ? 1u : 0u, map.count(std::int64_t(i)));
+	}
+}
+TEST(soa_flat_map, move_only)
+{
+	soa_flat_map<int, std::unique_ptr<int> > foo;
+	foo.emplace(5, new int(5));
+	foo.emplace(3, new int(3));
+	ASSERT_EQ(3, *foo.begin()->second);
+	ASSERT_EQ(5, *foo.at(5));
+}
+
+#endif
@@ -0,0 +1,521 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include "flat_map.hpp"
+#include <iterator>
+
+// a flat_map that keeps the keys and the values in two separate arrays.
+// searches only look at the key array, so big values don't get pulled
+// into the cache when looking something up. iterators dereference to a
+// std::pair<const K &, V &> so code written against flat_map mostly keeps
+// working. the exception is binding an element to a non-const lvalue
+// reference (for (auto & kv : map)) because there is no pair in memory
+// to refer to. use const auto & or auto && instead
+template<typename K, typename V, typename Comp = std::less<K>, typename KeyAllocator = std::allocator<K>, typename ValueAllocator = std::allocator<V> >
+struct soa_flat_map
+{
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<K, V> value_type;
+	typedef Comp key_compare;
+	struct value_compare
+	{
+		template<typename L, typename R>
+		bool operator()(const L & lhs, const R & rhs) const
+		{
+			return key_compare()(lhs.first, rhs.first);
+		}
+	};
+	typedef std::vector<K, KeyAllocator> key_container_type;
+	typedef std::vector<V, ValueAllocator> mapped_container_type;
+	typedef std::pair<const K &, V &> reference;
+	typedef std::pair<const K &, const V &> const_reference;
+	typedef typename key_container_type::size_type size_type;
+	typedef typename key_container_type::difference_type difference_type;
+
+	template<bool Const>
+	struct iterator_base
+	{
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef soa_flat_map::value_type value_type;
+		typedef soa_flat_map::difference_type difference_type;
+		typedef typename std::conditional<Const, const_reference, soa_flat_map::reference>::type reference;
+		typedef typename std::conditional<Const, const V *, V *>::type value_pointer;
+		// operator-> has to return something that lives long enough to
+		// have ->first and ->second called on it
+		struct pointer
+		{
+			reference ref;
+			const reference * operator->() const
+			{
+				return &ref;
+			}
+		};
+
+		iterator_base()
+			: key(nullptr), value(nullptr)
+		{
+		}
+		iterator_base(const K * key, value_pointer value)
+			: key(key), value(value)
+		{
+		}
+		template<bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+		iterator_base(const iterator_base<OtherConst> & other)
+			: key(other.key), value(other.value)
+		{
+		}
+
+		reference operator*() const
+		{
+			return reference(*key, *value);
+		}
+		pointer operator->() const
+		{
+			return pointer{ **this };
+		}
+		reference operator[](difference_type offset) const
+		{
+			return *(*this + offset);
+		}
+		iterator_base & operator++()
+		{
+			++key;
+			++value;
+			return *this;
+		}
+		iterator_base operator++(int)
+		{
+			iterator_base copy(*this);
+			++*this;
+			return copy;
+		}
+		iterator_base & operator--()
+		{
+			--key;
+			--value;
+			return *this;
+		}
+		iterator_base operator--(int)
+		{
+			iterator_base copy(*this);
+			--*this;
+			return copy;
+		}
+		iterator_base & operator+=(difference_type offset)
+		{
+			key += offset;
+			value += offset;
+			return *this;
+		}
+		iterator_base & operator-=(difference_type offset)
+		{
+			return *this += -offset;
+		}
+		iterator_base operator+(difference_type offset) const
+		{
+			return iterator_base(*this) += offset;
+		}
+		friend iterator_base operator+(difference_type offset, const iterator_base & it)
+		{
+			return it + offset;
+		}
+		iterator_base operator-(difference_type offset) const
+		{
+			return iterator_base(*this) -= offset;
+		}
+		difference_type operator-(const iterator_base & other) const
+		{
+			return key - other.key;
+		}
+
+		bool operator==(const iterator_base & other) const
+		{
+			return key == other.key;
+		}
+		bool operator!=(const iterator_base & other) const
+		{
+			return !(*this == other);
+		}
+		bool operator<(const iterator_base & other) const
+		{
+			return key < other.key;
+		}
+		bool operator>(const iterator_base & other) const
+		{
+			return other < *this;
+		}
+		bool operator<=(const iterator_base & other) const
+		{
+			return !(other < *this);
+		}
+		bool operator>=(const iterator_base & other) const
+		{
+			return !(*this < other);
+		}
+
+	private:
+		template<bool>
+		friend struct iterator_base;
+		friend struct soa_flat_map;
+		const K * key;
+		value_pointer value;
+	};
+	typedef iterator_base<false> iterator;
+	typedef iterator_base<true> const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	soa_flat_map() = default;
+	template<typename It>
+	soa_flat_map(It begin, It end)
+	{
+		insert(begin, end);
+	}
+	soa_flat_map(std::initializer_list<value_type> init)
+		: soa_flat_map(init.begin(), init.end())
+	{
+	}
+
+	iterator				begin()				{	return iterator(key_data.data(), value_data.data());	}
+	iterator				end()				{	return begin() + size();								}
+	const_iterator			begin()		const	{	return const_iterator(key_data.data(), value_data.data());	}
+	const_iterator			end()		const	{	return begin() + size();								}
+	const_iterator			cbegin()	const	{	return begin();											}
+	const_iterator			cend()		const	{	return end();											}
+	reverse_iterator		rbegin()			{	return reverse_iterator(end());							}
+	reverse_iterator		rend()				{	return reverse_iterator(begin());						}
+	const_reverse_iterator	rbegin()	const	{	return const_reverse_iterator(end());					}
+	const_reverse_iterator	rend()		const	{	return const_reverse_iterator(begin());					}
+	const_reverse_iterator	crbegin()	const	{	return rbegin();										}
+	const_reverse_iterator	crend()		const	{	return rend();											}
+
+	bool empty() const
+	{
+		return key_data.empty();
+	}
+	size_type size() const
+	{
+		return key_data.size();
+	}
+	size_type max_size() const
+	{
+		return std::min(key_data.max_size(), value_data.max_size());
+	}
+	size_type capacity() const
+	{
+		return std::min(key_data.capacity(), value_data.capacity());
+	}
+	void reserve(size_type size)
+	{
+		key_data.reserve(size);
+		value_data.reserve(size);
+	}
+	void shrink_to_fit()
+	{
+		key_data.shrink_to_fit();
+		value_data.shrink_to_fit();
+	}
+
+	// the two arrays. keys() is sorted
+	const key_container_type & keys() const
+	{
+		return key_data;
+	}
+	const mapped_container_type & values() const
+	{
+		return value_data;
+	}
+
+	mapped_type & operator[](const key_type & key)
+	{
+		return emplace_at(lower_bound_index(key), key).first->second;
+	}
+	mapped_type & operator[](key_type && key)
+	{
+		return emplace_at(lower_bound_index(key), std::move(key)).first->second;
+	}
+	mapped_type & at(const key_type & key)
+	{
+		size_type found = find_index(key);
+		if (found == size()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return value_data[found];
+	}
+	const mapped_type & at(const key_type & key) const
+	{
+		size_type found = find_index(key);
+		if (found == size()) detail::throw_out_of_range("key passed to 'at' doesn't exist in this map");
+		return value_data[found];
+	}
+	std::pair<iterator, bool> insert(value_type && value)
+	{
+		return emplace(std::move(value));
+	}
+	std::pair<iterator, bool> insert(const value_type & value)
+	{
+		return emplace(value);
+	}
+	iterator insert(const_iterator hint, value_type && value)
+	{
+		return emplace_hint(hint, std::move(value));
+	}
+	iterator insert(const_iterator hint, const value_type & value)
+	{
+		return emplace_hint(hint, value);
+	}
+	// sorts the new elements on their own and then merges them with the
+	// existing ones into new arrays. O(n + m log(m)) where n is the number
+	// of elements in the map and m is std::distance(begin, end).
+	// like for flat_map, the first of several equal keys wins
+	template<typename It>
+	void insert(It begin, It end)
+	{
+		std::vector<value_type> sorted(begin, end);
+		if (sorted.empty()) return;
+		value_compare comp;
+		std::stable_sort(sorted.begin(), sorted.end(), comp);
+		sorted.erase(std::unique(sorted.begin(), sorted.end(), [&comp](const value_type & lhs, const value_type & rhs)
+		{
+			return !comp(lhs, rhs);
+		}), sorted.end());
+		key_container_type keys(key_data.get_allocator());
+		mapped_container_type values(value_data.get_allocator());
+		keys.reserve(key_data.size() + sorted.size());
+		values.reserve(value_data.size() + sorted.size());
+		key_compare key_comp;
+		size_type old = 0;
+		for (value_type & value : sorted)
+		{
+			for (; old < key_data.size() && key_comp(key_data[old], value.first); ++old)
+			{
+				keys.push_back(std::move(key_data[old]));
+				values.push_back(std::move(value_data[old]));
+			}
+			if (old < key_data.size() && !key_comp(value.first, key_data[old])) continue;
+			keys.push_back(std::move(value.first));
+			values.push_back(std::move(value.second));
+		}
+		for (; old < key_data.size(); ++old)
+		{
+			keys.push_back(std::move(key_data[old]));
+			values.push_back(std::move(value_data[old]));
+		}
+		key_data.swap(keys);
+		value_data.swap(values);
+	}
+	void insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+	iterator erase(const_iterator it)
+	{
+		size_type index = it - cbegin();
+		key_data.erase(key_data.begin() + index);
+		value_data.erase(value_data.begin() + index);
+		return begin() + index;
+	}
+	size_type erase(const key_type & key)
+	{
+		size_type found = find_index(key);
+		if (found == size()) return 0;
+		erase(begin() + found);
+		return 1;
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		size_type index = first - cbegin();
+		size_type end_index = last - cbegin();
+		key_data.erase(key_data.begin() + index, key_data.begin() + end_index);
+		value_data.erase(value_data.begin() + index, value_data.begin() + end_index);
+		return begin() + index;
+	}
+	void swap(soa_flat_map & other)
+	{
+		key_data.swap(other.key_data);
+		value_data.swap(other.value_data);
+	}
+	void clear()
+	{
+		key_data.clear();
+		value_data.clear();
+	}
+	// unlike flat_map, the first argument has to be the key. the remaining
+	// arguments are used to construct the value
+	template<typename KeyArg, typename... Args, typename = typename std::enable_if<sizeof...(Args) != 0 || !std::is_same<typename std::decay<KeyArg>::type, value_type>::value>::type>
+	std::pair<iterator, bool> emplace(KeyArg && key, Args &&... args)
+	{
+		return emplace_at(lower_bound_index(key), std::forward<KeyArg>(key), std::forward<Args>(args)...);
+	}
+	std::pair<iterator, bool> emplace(const value_type & value)
+	{
+		return emplace(value.first, value.second);
+	}
+	std::pair<iterator, bool> emplace(value_type && value)
+	{
+		return emplace(std::move(value.first), std::move(value.second));
+	}
+	template<typename KeyArg, typename... Args, typename = typename std::enable_if<sizeof...(Args) != 0 || !std::is_same<typename std::decay<KeyArg>::type, value_type>::value>::type>
+	iterator emplace_hint(const_iterator hint, KeyArg && key, Args &&... args)
+	{
+		key_compare comp;
+		size_type index = hint - cbegin();
+		if ((index == size() || comp(key, key_data[index])) && (index == 0 || comp(key_data[index - 1], key)))
+			return emplace_at(index, std::forward<KeyArg>(key), std::forward<Args>(args)...).first;
+		else return emplace(std::forward<KeyArg>(key), std::forward<Args>(args)...).first;
+	}
+	iterator emplace_hint(const_iterator hint, const value_type & value)
+	{
+		return emplace_hint(hint, value.first, value.second);
+	}
+	iterator emplace_hint(const_iterator hint, value_type && value)
+	{
+		return emplace_hint(hint, std::move(value.first), std::move(value.second));
+	}
+
+	key_compare key_comp() const
+	{
+		return key_compare();
+	}
+	value_compare value_comp() const
+	{
+		return value_compare();
+	}
+
+	template<typename T>
+	iterator find(const T & key)
+	{
+		return begin() + find_index(key);
+	}
+	template<typename T>
+	const_iterator find(const T & key) const
+	{
+		return begin() + find_index(key);
+	}
+	template<typename T>
+	size_type count(const T & key) const
+	{
+		return find_index(key) == size() ? 0 : 1;
+	}
+	template<typename T>
+	iterator lower_bound(const T & key)
+	{
+		return begin() + lower_bound_index(key);
+	}
+	template<typename T>
+	const_iterator lower_bound(const T & key) const
+	{
+		return begin() + lower_bound_index(key);
+	}
+	template<typename T>
+	iterator upper_bound(const T & key)
+	{
+		return begin() + upper_bound_index(key);
+	}
+	template<typename T>
+	const_iterator upper_bound(const T & key) const
+	{
+		return begin() + upper_bound_index(key);
+	}
+	template<typename T>
+	std::pair<iterator, iterator> equal_range(const T & key)
+	{
+		return { lower_bound(key), upper_bound(key) };
+	}
+	template<typename T>
+	std::pair<const_iterator, const_iterator> equal_range(const T & key) const
+	{
+		return { lower_bound(key), upper_bound(key) };
+	}
+
+	bool operator==(const soa_flat_map & other) const
+	{
+		return key_data == other.key_data && value_data == other.value_data;
+	}
+	bool operator!=(const soa_flat_map & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	key_container_type key_data;
+	mapped_container_type value_data;
+
+	template<typename KeyArg, typename... Args>
+	std::pair<iterator, bool> emplace_at(size_type index, KeyArg && key, Args &&... args)
+	{
+		if (index != size() && !key_compare()(key, key_data[index])) return { begin() + index, false };
+		key_data.emplace(key_data.begin() + index, std::forward<KeyArg>(key));
+		try
+		{
+			value_data.emplace(value_data.begin() + index, std::forward<Args>(args)...);
+		}
+		catch(...)
+		{
+			key_data.erase(key_data.begin() + index);
+			throw;
+		}
+		return { begin() + index, true };
+	}
+
+	// the same search as in flat_map, except that the keys are next to
+	// each other, so the SIMD scan doesn't need gather instructions
+	template<typename T>
+	size_type lower_bound_index(const T & key) const
+	{
+		return lower_bound_index(key, std::integral_constant<bool, use_branchless_search<key_type, key_compare>::value
+																	&& std::is_same<T, key_type>::value>());
+	}
+	template<typename T>
+	size_type lower_bound_index(const T & key, std::false_type) const
+	{
+		return std::lower_bound(key_data.begin(), key_data.end(), key, key_compare()) - key_data.begin();
+	}
+	size_type lower_bound_index(const key_type & key, std::true_type) const
+	{
+		return detail::branchless_lower_bound(key_data.data(), key_data.size(), key);
+	}
+	template<typename T>
+	size_type upper_bound_index(const T & key) const
+	{
+		return std::upper_bound(key_data.begin(), key_data.end(), key, key_compare()) - key_data.begin();
+	}
+	template<typename T>
+	size_type find_index(const T & key) const
+	{
+		size_type lower = lower_bound_index(key);
+		if (lower == size() || key_compare()(key, key_data[lower])) return size();
+		else return lower;
+	}
+};
+
+template<typename K, typename V, typename C, typename KA, typename VA>
+void swap(soa_flat_map<K, V, C, KA, VA> & lhs, soa_flat_map<K, V, C, KA, VA> & rhs)
+{
+	lhs.swap(rhs);
+}
@@ -0,0 +1,81 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#include "static_flat_map.hpp"
+
+namespace
+{
+constexpr auto opcodes = make_static_flat_map<int, const char *>({ { 5, "write" }, { 1, "open" }, { 3, "read" }, { 2, "close" }, { 8, "seek" } });
+static_assert(opcodes.size() == 5, "");
+static_assert(opcodes.begin()->first == 1, "the elements should be sorted");
+static_assert(opcodes.count(3) == 1 && opcodes.count(4) == 0, "");
+static_assert(opcodes.find(4) == opcodes.end(), "");
+static_assert(opcodes.at(8)[1] == 'e', "");
+static_assert(opcodes.lower_bound(4)->first == 5, "");
+
+constexpr auto config_names = make_static_flat_map<const char *, int, c_string_less>({ { "timeout", 1 }, { "retries", 2 }, { "port", 3 }, { "host", 4 } });
+static_assert(config_names.at("port") == 3, "");
+static_assert(config_names.count("ports") == 0, "");
+static_assert(config_names.begin()->second == 4, "host comes first");
+}
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(static_flat_map, lookups)
+{
+	int key = 5;
+	ASSERT_EQ(std::string("write"), opcodes.at(key));
+	ASSERT_THROW(opcodes.at(key + 1), std::out_of_range);
+	std::string sorted;
+	for (const auto & opcode : opcodes)
+		sorted += std::to_string(opcode.first);
+	ASSERT_EQ("12358", sorted);
+	std::string name = "retries";
+	ASSERT_EQ(2, config_names.at(name.c_str()));
+	ASSERT_EQ(config_names.end(), config_names.find(""));
+}
+TEST(static_flat_map, runtime)
+{
+	// sorting at runtime works too, and checks for duplicates with an
+	// exception instead of a compile error
+	std::pair<int, int> init[] = { { 3, 0 }, { 1, 1 }, { 2, 2 } };
+	static_flat_map<int, int, 3> map(init);
+	ASSERT_EQ(1, map.begin()->first);
+	ASSERT_EQ(2, map.at(2));
+	std::pair<int, int> duplicates[] = { { 3, 0 }, { 1, 1 }, { 3, 2 } };
+	ASSERT_THROW((static_flat_map<int, int, 3>(duplicates)), std::invalid_argument);
+	std::pair<int, int> many[1000];
+	for (int i = 0; i < 1000; ++i)
+		many[i] = { (i * 7919) % 1000, i };
+	static_flat_map<int, int, 1000> big(many);
+	for (int i = 0; i < 1000; ++i)
+		ASSERT_EQ(i, (big.begin() + i)->first);
+}
+
+#endif
@@ -0,0 +1,190 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+// a read-only flat_map that gets sorted at compile time. for lookup tables
+// that are known when compiling, like opcodes or config names:
+// constexpr auto opcodes = make_static_flat_map<int, const char *>({
+//     { 3, "read" }, { 1, "open" }, { 2, "close" } });
+// if the map is constexpr there is no code that runs at startup and no
+// allocation, the elements are in read-only data. find, count, lower_bound
+// and at can be used in constant expressions too. a duplicate key is a
+// compile error in a constexpr map and throws std::invalid_argument if the
+// map is built at runtime.
+//
+// this doesn't include flat_map.hpp or <vector> so that it stays cheap to
+// compile. the keys and values have to be literal types, and the
+// comparison has to be constexpr. std::less isn't useful for string
+// literals, use c_string_less for those
+
+// like std::pair, except that it can be assigned in a constant expression
+// in C++14, which the sort needs
+template<typename K, typename V>
+struct static_flat_map_element
+{
+	K first;
+	V second;
+};
+
+struct c_string_less
+{
+	constexpr bool operator()(const char * lhs, const char * rhs) const
+	{
+		for (; *lhs && *lhs == *rhs; ++lhs, ++rhs)
+		{
+		}
+		return static_cast<unsigned char>(*lhs) < static_cast<unsigned char>(*rhs);
+	}
+};
+
+template<typename K, typename V, size_t N, typename Comp = std::less<K> >
+struct static_flat_map
+{
+	static_assert(N > 0, "a static_flat_map needs at least one element");
+
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef static_flat_map_element<K, V> value_type;
+	typedef Comp key_compare;
+	typedef size_t size_type;
+	typedef const value_type & reference;
+	typedef const value_type & const_reference;
+	typedef const value_type * iterator;
+	typedef const value_type * const_iterator;
+
+	constexpr explicit static_flat_map(const std::pair<K, V> (&init)[N])
+		: static_flat_map(init, std::make_index_sequence<N>())
+	{
+	}
+
+	constexpr const_iterator begin() const
+	{
+		return elements;
+	}
+	constexpr const_iterator end() const
+	{
+		return elements + N;
+	}
+	constexpr size_type size() const
+	{
+		return N;
+	}
+	constexpr bool empty() const
+	{
+		return false;
+	}
+
+	constexpr const_iterator lower_bound(const key_type & key) const
+	{
+		size_t begin = 0;
+		size_t end = N;
+		while (begin != end)
+		{
+			size_t middle = begin + (end - begin) / 2;
+			if (key_compare()(elements[middle].first, key))
+				begin = middle + 1;
+			else
+				end = middle;
+		}
+		return elements + begin;
+	}
+	constexpr const_iterator find(const key_type & key) const
+	{
+		const_iterator lower = lower_bound(key);
+		if (lower == end() || key_compare()(key, lower->first)) return end();
+		else return lower;
+	}
+	constexpr size_type count(const key_type & key) const
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+	constexpr const mapped_type & at(const key_type & key) const
+	{
+		const_iterator found = find(key);
+		if (found == end()) throw std::out_of_range("key passed to 'at' doesn't exist in this map");
+		return found->second;
+	}
+
+private:
+	value_type elements[N];
+
+	template<size_t... I>
+	constexpr static_flat_map(const std::pair<K, V> (&init)[N], std::index_sequence<I...>)
+		: elements{ { init[I].first, init[I].second }... }
+	{
+		sort();
+		for (size_t i = 1; i < N; ++i)
+		{
+			if (!key_compare()(elements[i - 1].first, elements[i].first))
+				throw std::invalid_argument("duplicate key in static_flat_map");
+		}
+	}
+
+	// std::sort and std::swap aren't constexpr in C++14. this is a heap
+	// sort so that big tables don't get quadratic compile times
+	constexpr void sort()
+	{
+		for (size_t i = N / 2; i > 0; --i)
+			sift_down(i - 1, N);
+		for (size_t end = N - 1; end > 0; --end)
+		{
+			swap_elements(elements[0], elements[end]);
+			sift_down(0, end);
+		}
+	}
+	constexpr void sift_down(size_t root, size_t end)
+	{
+		for (size_t child = root * 2 + 1; child < end; child = root * 2 + 1)
+		{
+			if (child + 1 < end && key_compare()(elements[child].first, elements[child + 1].first))
+				++child;
+			if (!key_compare()(elements[root].first, elements[child].first))
+				return;
+			swap_elements(elements[root], elements[child]);
+			root = child;
+		}
+	}
+	static constexpr void swap_elements(value_type & lhs, value_type & rhs)
+	{
+		value_type tmp = lhs;
+		lhs = rhs;
+		rhs = tmp;
+	}
+};
+
+// deduces the size from the initializer list
+template<typename K, typename V, typename Comp = std::less<K>, size_t N>
+constexpr static_flat_map<K, V, N, Comp> make_static_flat_map(const std::pair<K, V> (&init)[N])
+{
+	return static_flat_map<K, V, N, Comp>(init);
+}
@@ -0,0 +1,144 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+#include "tiered_vector.hpp"
+
+#ifndef DISABLE_GTEST
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "flat_map.hpp"
+
+TEST(tiered_vector, grow)
+{
+	tiered_vector<std::string> vector;
+	for (int i = 0; i < 1000; ++i)
+		vector.emplace_back(std::to_string(i));
+	// 1000 elements don't fit into 16 chunks of 16
+	ASSERT_EQ(32u, vector.chunk_size());
+	ASSERT_EQ(1024u, vector.capacity());
+	for (int i = 0; i < 1000; ++i)
+		ASSERT_EQ(std::to_string(i), vector[i]);
+	vector.emplace_back(vector.front());
+	ASSERT_EQ("0", vector.back());
+	while (vector.size() > 10)
+		vector.pop_back();
+	vector.shrink_to_fit();
+	ASSERT_EQ(16u, vector.chunk_size());
+	ASSERT_EQ(16u, vector.capacity());
+	ASSERT_EQ((tiered_vector<std::string>{ "0", "1", "2", "3", "4", "5", "6", "7", "8", "9" }), vector);
+}
+TEST(tiered_vector, emplace_and_erase)
+{
+	tiered_vector<std::string> vector{ "a", "c" };
+	vector.emplace(vector.begin() + 1, "b");
+	vector.emplace(vector.begin(), "0");
+	vector.emplace(vector.end(), "d");
+	vector.insert(vector.begin() + 2, vector[4]);
+	ASSERT_EQ((tiered_vector<std::string>{ "0", "a", "d", "b", "c", "d" }), vector);
+	vector.erase(vector.begin() + 2);
+	ASSERT_EQ((tiered_vector<std::string>{ "0", "a", "b", "c", "d" }), vector);
+	vector.erase(vector.begin(), vector.begin() + 2);
+	ASSERT_EQ((tiered_vector<std::string>{ "b", "c", "d" }), vector);
+}
+TEST(tiered_vector, random_inserts_and_erases)
+{
+	// compares against std::vector at every position in every chunk, which
+	// covers the rotations at chunk boundaries and the partial last chunk
+	std::mt19937 randomness(5);
+	tiered_vector<std::string> tiered;
+	std::vector<std::string> normal;
+	for (int i = 0; i < 3000; ++i)
+	{
+		size_t index = randomness() % (normal.size() + 1);
+		if (normal.empty() || randomness() % 3 != 0)
+		{
+			std::string value = std::to_string(i);
+			tiered.emplace(tiered.begin() + index, value);
+			normal.emplace(normal.begin() + index, value);
+		}
+		else
+		{
+			if (index == normal.size()) --index;
+			size_t count = std::min<size_t>(randomness() % 4 == 0 ? 40 : 1, normal.size() - index);
+			tiered.erase(tiered.begin() + index, tiered.begin() + index + count);
+			normal.erase(normal.begin() + index, normal.begin() + index + count);
+		}
+		ASSERT_TRUE(std::equal(normal.begin(), normal.end(), tiered.begin(), tiered.end()));
+	}
+}
+TEST(tiered_vector, move_and_swap)
+{
+	tiered_vector<std::string> small{ "a" };
+	tiered_vector<std::string> big{ "b", "c", "d" };
+	const std::string * big_data = &big.front();
+	small.swap(big);
+	ASSERT_EQ((tiered_vector<std::string>{ "b", "c", "d" }), small);
+	ASSERT_EQ((tiered_vector<std::string>{ "a" }), big);
+	ASSERT_EQ(big_data, &small.front());
+	tiered_vector<std::string> moved(std::move(big));
+	ASSERT_TRUE(big.empty());
+	ASSERT_EQ("a", moved.front());
+	moved = small;
+	ASSERT_EQ(small, moved);
+	ASSERT_NE(&small.front(), &moved.front());
+}
+TEST(tiered_vector, flat_map)
+{
+	typedef flat_map<int, int, std::less<int>, tiered_vector<std::pair<int, int> > > tiered_map;
+	std::mt19937 randomness(5);
+	for (int size : { 0, 1, 16, 17, 300, 5000 })
+	{
+		tiered_map tiered;
+		flat_map<int, int> normal;
+		for (int i = 0; i < size; ++i)
+		{
+			int key = randomness() % 10000;
+			tiered.emplace(key, i);
+			normal.emplace(key, i);
+		}
+		std::vector<std::pair<int, int> > batch{ { 5, 1 }, { 50000, 2 }, { 3, 3 } };
+		tiered.insert(batch.begin(), batch.end());
+		normal.insert(batch.begin(), batch.end());
+		ASSERT_TRUE(std::equal(normal.begin(), normal.end(), tiered.begin(), tiered.end()));
+		for (int i = -1; i <= 10001; i += 7)
+		{
+			ASSERT_EQ(normal.lower_bound(i) - normal.begin(), tiered.lower_bound(i) - tiered.begin());
+			ASSERT_EQ(normal.count(i), tiered.count(i));
+			tiered.erase(i);
+			normal.erase(i);
+		}
+		tiered.erase(50000);
+		ASSERT_EQ(normal.size() - 1, tiered.size());
+	}
+	tiered_map map{ { 1, 2 }, { 3, 4 } };
+	ASSERT_EQ(4, map[3]);
+	ASSERT_EQ(0, map[2]);
+	ASSERT_EQ(2, map.begin()->second);
+}
+
+#endif
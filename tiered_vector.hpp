@@ -0,0 +1,647 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// a vector that is split into chunks of equal size. every chunk is a
+// circular buffer and all chunks except the last one are full, so element
+// i is always in chunk i / chunk_size(). inserting or erasing in the middle
+// shifts elements inside of one chunk and then rotates each following chunk
+// by one, which moves O(sqrt(n)) elements instead of O(n). meant as the
+// container of a big flat_map that gets a lot of inserts and erases:
+// flat_map<K, V, std::less<K>, tiered_vector<std::pair<K, V> > >
+// the chunk size is a power of two and doubles once there would be more
+// chunks than elements per chunk, which moves every element once. the
+// elements are not contiguous so lookups use std::lower_bound on the
+// iterators instead of the SIMD search. iterators are indices, so they stay
+// valid when the container grows but point at a different element after an
+// insert or erase in front of them
+template<typename T, typename Allocator = std::allocator<T> >
+struct tiered_vector
+{
+private:
+	template<bool Const>
+	struct basic_iterator;
+public:
+	typedef T value_type;
+	typedef Allocator allocator_type;
+	typedef std::allocator_traits<allocator_type> allocator_traits;
+	typedef T & reference;
+	typedef const T & const_reference;
+	typedef T * pointer;
+	typedef const T * const_pointer;
+	typedef basic_iterator<false> iterator;
+	typedef basic_iterator<true> const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef std::ptrdiff_t difference_type;
+	typedef std::size_t size_type;
+
+	static constexpr size_type min_chunk_size = 16;
+
+	tiered_vector() = default;
+	explicit tiered_vector(const allocator_type & allocator)
+		: allocator(allocator), chunks(chunk_allocator(allocator))
+	{
+	}
+	template<typename It, typename = typename std::iterator_traits<It>::iterator_category>
+	tiered_vector(It begin, It end, const allocator_type & allocator = allocator_type())
+		: tiered_vector(allocator)
+	{
+		for (; begin != end; ++begin)
+			emplace_back(*begin);
+	}
+	tiered_vector(std::initializer_list<T> il, const allocator_type & allocator = allocator_type())
+		: tiered_vector(il.begin(), il.end(), allocator)
+	{
+	}
+	tiered_vector(const tiered_vector & other)
+		: tiered_vector(allocator_traits::select_on_container_copy_construction(other.allocator))
+	{
+		reserve(other.size());
+		for (const T & value : other)
+			emplace_back(value);
+	}
+	tiered_vector(tiered_vector && other)
+		: allocator(other.allocator), chunks(std::move(other.chunks)), num_elements(other.num_elements), shift(other.shift)
+	{
+		other.chunks.clear();
+		other.num_elements = 0;
+		other.shift = min_shift;
+	}
+	tiered_vector & operator=(const tiered_vector & other)
+	{
+		if (this != &other)
+		{
+			tiered_vector copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	tiered_vector & operator=(tiered_vector && other)
+	{
+		if (this != &other)
+		{
+			clear();
+			deallocate_chunks(0);
+			allocator = other.allocator;
+			chunks = std::move(other.chunks);
+			num_elements = other.num_elements;
+			shift = other.shift;
+			other.chunks.clear();
+			other.num_elements = 0;
+			other.shift = min_shift;
+		}
+		return *this;
+	}
+	~tiered_vector()
+	{
+		clear();
+		deallocate_chunks(0);
+	}
+
+	iterator				begin()				{	return iterator(this, 0);					}
+	iterator				end()				{	return iterator(this, num_elements);		}
+	const_iterator			begin()		const	{	return const_iterator(this, 0);				}
+	const_iterator			end()		const	{	return const_iterator(this, num_elements);	}
+	const_iterator			cbegin()	const	{	return begin();		}
+	const_iterator			cend()		const	{	return end();		}
+	reverse_iterator		rbegin()			{	return reverse_iterator(end());			}
+	reverse_iterator		rend()				{	return reverse_iterator(begin());		}
+	const_reverse_iterator	rbegin()	const	{	return const_reverse_iterator(end());	}
+	const_reverse_iterator	rend()		const	{	return const_reverse_iterator(begin());	}
+	const_reverse_iterator	crbegin()	const	{	return rbegin();	}
+	const_reverse_iterator	crend()		const	{	return rend();		}
+
+	T & operator[](size_type index)
+	{
+		return element(index);
+	}
+	const T & operator[](size_type index) const
+	{
+		return element(index);
+	}
+	T & front()
+	{
+		return element(0);
+	}
+	const T & front() const
+	{
+		return element(0);
+	}
+	T & back()
+	{
+		return element(num_elements - 1);
+	}
+	const T & back() const
+	{
+		return element(num_elements - 1);
+	}
+
+	bool empty() const
+	{
+		return num_elements == 0;
+	}
+	size_type size() const
+	{
+		return num_elements;
+	}
+	size_type max_size() const
+	{
+		return allocator_traits::max_size(allocator);
+	}
+	size_type capacity() const
+	{
+		return chunks.size() << shift;
+	}
+	size_type chunk_size() const
+	{
+		return size_type(1) << shift;
+	}
+	void reserve(size_type new_capacity)
+	{
+		if (new_capacity > capacity()) grow(new_capacity);
+	}
+	// frees the chunks that are not in use and makes the chunks smaller if
+	// they are bigger than they need to be for the current size
+	void shrink_to_fit()
+	{
+		size_type best_shift = shift_for(num_elements);
+		if (best_shift < shift) rechunk(best_shift, num_elements);
+		else deallocate_chunks(num_chunks_for(num_elements));
+	}
+	allocator_type get_allocator() const
+	{
+		return allocator;
+	}
+
+	template<typename... Args>
+	T & emplace_back(Args &&... args)
+	{
+		if (num_elements == capacity())
+		{
+			// construct first in case args refers to an element
+			T value(std::forward<Args>(args)...);
+			grow(grown_capacity());
+			allocator_traits::construct(allocator, std::addressof(element(num_elements)), std::move(value));
+		}
+		else allocator_traits::construct(allocator, std::addressof(element(num_elements)), std::forward<Args>(args)...);
+		return element(num_elements++);
+	}
+	void push_back(const T & value)
+	{
+		emplace_back(value);
+	}
+	void push_back(T && value)
+	{
+		emplace_back(std::move(value));
+	}
+	void pop_back()
+	{
+		allocator_traits::destroy(allocator, std::addressof(back()));
+		--num_elements;
+	}
+	// the new element goes into the chunk at position. the full chunks
+	// after it each pass their last element on to the front of the next
+	// chunk, which is a rotation of the circular buffer
+	template<typename... Args>
+	iterator emplace(const_iterator position, Args &&... args)
+	{
+		size_type index = position.index;
+		if (index == num_elements)
+		{
+			emplace_back(std::forward<Args>(args)...);
+			return begin() + index;
+		}
+		T value(std::forward<Args>(args)...);
+		if (num_elements == capacity()) grow(grown_capacity());
+		size_type last_chunk = num_elements >> shift;
+		size_type offset = index & mask();
+		for (size_type i = index >> shift; i < last_chunk; ++i, offset = 0)
+			insert_into_full_chunk(chunks[i], offset, value);
+		insert_into_last_chunk(chunks[last_chunk], offset, std::move(value));
+		++num_elements;
+		return begin() + index;
+	}
+	iterator insert(const_iterator position, const T & value)
+	{
+		return emplace(position, value);
+	}
+	iterator insert(const_iterator position, T && value)
+	{
+		return emplace(position, std::move(value));
+	}
+	// the reverse of emplace: the chunks after position each pass their
+	// first element on to the back of the chunk in front of them
+	iterator erase(const_iterator position)
+	{
+		size_type index = position.index;
+		size_type last_chunk = (num_elements - 1) >> shift;
+		size_type offset = index & mask();
+		for (size_type i = index >> shift; i < last_chunk; ++i, offset = 0)
+		{
+			remove_from_chunk(chunks[i], offset, mask());
+			at(chunks[i], mask()) = std::move(at(chunks[i + 1], 0));
+		}
+		chunk & last = chunks[last_chunk];
+		size_type last_index = remove_from_chunk(last, offset, (num_elements - 1) & mask());
+		allocator_traits::destroy(allocator, std::addressof(at(last, last_index)));
+		if (last_index == 0) last.head = (last.head + 1) & mask();
+		--num_elements;
+		return begin() + index;
+	}
+	// erasing a few elements erases them one at a time, erasing many moves
+	// everything after them forward like a std::vector would
+	iterator erase(const_iterator begin, const_iterator end)
+	{
+		size_type index = begin.index;
+		size_type count = end.index - begin.index;
+		if (end.index == num_elements)
+		{
+			for (; count > 0; --count)
+				pop_back();
+		}
+		else if (count * (chunk_size() + chunks.size()) < num_elements - end.index)
+		{
+			for (; count > 0; --count)
+				erase(this->begin() + index);
+		}
+		else
+		{
+			std::move(this->begin() + end.index, this->end(), this->begin() + index);
+			for (; count > 0; --count)
+				pop_back();
+		}
+		return this->begin() + index;
+	}
+	void clear()
+	{
+		while (!empty())
+			pop_back();
+	}
+	void swap(tiered_vector & other)
+	{
+		using std::swap;
+		swap(allocator, other.allocator);
+		swap(chunks, other.chunks);
+		swap(num_elements, other.num_elements);
+		swap(shift, other.shift);
+	}
+
+	bool operator==(const tiered_vector & other) const
+	{
+		return size() == other.size() && std::equal(begin(), end(), other.begin());
+	}
+	bool operator!=(const tiered_vector & other) const
+	{
+		return !(*this == other);
+	}
+	bool operator<(const tiered_vector & other) const
+	{
+		return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+	}
+	bool operator>(const tiered_vector & other) const
+	{
+		return other < *this;
+	}
+	bool operator<=(const tiered_vector & other) const
+	{
+		return !(other < *this);
+	}
+	bool operator>=(const tiered_vector & other) const
+	{
+		return !(*this < other);
+	}
+
+private:
+	// the top level index. head is the position of the first element in
+	// the circular buffer
+	struct chunk
+	{
+		T * elements;
+		size_type head;
+	};
+	typedef typename allocator_traits::template rebind_alloc<chunk> chunk_allocator;
+
+	static constexpr size_type min_shift = 4;
+	static_assert(size_type(1) << min_shift == min_chunk_size, "min_shift has to match min_chunk_size");
+
+	allocator_type allocator;
+	std::vector<chunk, chunk_allocator> chunks;
+	size_type num_elements = 0;
+	size_type shift = min_shift;
+
+	template<bool Const>
+	struct basic_iterator
+	{
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef typename std::conditional<Const, const T *, T *>::type pointer;
+		typedef typename std::conditional<Const, const T &, T &>::type reference;
+		typedef typename std::conditional<Const, const tiered_vector *, tiered_vector *>::type container_pointer;
+
+		basic_iterator() = default;
+		basic_iterator(container_pointer container, size_type index)
+			: container(container), index(index)
+		{
+		}
+		template<bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+		basic_iterator(const basic_iterator<OtherConst> & other)
+			: container(other.container), index(other.index)
+		{
+		}
+
+		reference operator*() const
+		{
+			return container->element(index);
+		}
+		pointer operator->() const
+		{
+			return std::addressof(**this);
+		}
+		reference operator[](difference_type offset) const
+		{
+			return container->element(index + offset);
+		}
+		basic_iterator & operator++()
+		{
+			++index;
+			return *this;
+		}
+		basic_iterator operator++(int)
+		{
+			basic_iterator copy(*this);
+			++index;
+			return copy;
+		}
+		basic_iterator & operator--()
+		{
+			--index;
+			return *this;
+		}
+		basic_iterator operator--(int)
+		{
+			basic_iterator copy(*this);
+			--index;
+			return copy;
+		}
+		basic_iterator & operator+=(difference_type offset)
+		{
+			index += offset;
+			return *this;
+		}
+		basic_iterator & operator-=(difference_type offset)
+		{
+			index -= offset;
+			return *this;
+		}
+		basic_iterator operator+(difference_type offset) const
+		{
+			return basic_iterator(container, index + offset);
+		}
+		friend basic_iterator operator+(difference_type offset, const basic_iterator & it)
+		{
+			return it + offset;
+		}
+		basic_iterator operator-(difference_type offset) const
+		{
+			return basic_iterator(container, index - offset);
+		}
+		template<bool OtherConst>
+		difference_type operator-(const basic_iterator<OtherConst> & other) const
+		{
+			return difference_type(index) - difference_type(other.index);
+		}
+		template<bool OtherConst>
+		bool operator==(const basic_iterator<OtherConst> & other) const
+		{
+			return index == other.index;
+		}
+		template<bool OtherConst>
+		bool operator!=(const basic_iterator<OtherConst> & other) const
+		{
+			return index != other.index;
+		}
+		template<bool OtherConst>
+		bool operator<(const basic_iterator<OtherConst> & other) const
+		{
+			return index < other.index;
+		}
+		template<bool OtherConst>
+		bool operator>(const basic_iterator<OtherConst> & other) const
+		{
+			return index > other.index;
+		}
+		template<bool OtherConst>
+		bool operator<=(const basic_iterator<OtherConst> & other) const
+		{
+			return index <= other.index;
+		}
+		template<bool OtherConst>
+		bool operator>=(const basic_iterator<OtherConst> & other) const
+		{
+			return index >= other.index;
+		}
+
+	private:
+		friend struct tiered_vector;
+		template<bool>
+		friend struct basic_iterator;
+		container_pointer container = nullptr;
+		size_type index = 0;
+	};
+
+	size_type mask() const
+	{
+		return chunk_size() - 1;
+	}
+	T & at(chunk & c, size_type offset)
+	{
+		return c.elements[(c.head + offset) & mask()];
+	}
+	T & element(size_type index)
+	{
+		return at(chunks[index >> shift], index);
+	}
+	const T & element(size_type index) const
+	{
+		const chunk & c = chunks[index >> shift];
+		return c.elements[(c.head + index) & mask()];
+	}
+	// puts value at offset in a full chunk and gives back the element that
+	// fell off the end in value. shifts whichever side of offset is shorter
+	void insert_into_full_chunk(chunk & c, size_type offset, T & value)
+	{
+		T out(std::move(at(c, mask())));
+		if (offset > mask() / 2)
+		{
+			for (size_type i = mask(); i > offset; --i)
+				at(c, i) = std::move(at(c, i - 1));
+		}
+		else
+		{
+			// the last slot becomes the first
+			c.head = (c.head - 1) & mask();
+			for (size_type i = 0; i < offset; ++i)
+				at(c, i) = std::move(at(c, i + 1));
+		}
+		at(c, offset) = std::move(value);
+		value = std::move(out);
+	}
+	// the last chunk has at least one free slot, so value can go in by
+	// moving either the front into the slot before head or the back into
+	// the slot after the last element
+	void insert_into_last_chunk(chunk & c, size_type offset, T && value)
+	{
+		size_type count = num_elements & mask();
+		if (offset == count)
+			allocator_traits::construct(allocator, std::addressof(at(c, count)), std::move(value));
+		else if (offset < count - offset)
+		{
+			size_type new_head = (c.head - 1) & mask();
+			allocator_traits::construct(allocator, c.elements + new_head, std::move(offset == 0 ? value : at(c, 0)));
+			c.head = new_head;
+			if (offset == 0) return;
+			for (size_type i = 1; i < offset; ++i)
+				at(c, i) = std::move(at(c, i + 1));
+			at(c, offset) = std::move(value);
+		}
+		else
+		{
+			allocator_traits::construct(allocator, std::addressof(at(c, count)), std::move(at(c, count - 1)));
+			for (size_type i = count - 1; i > offset; --i)
+				at(c, i) = std::move(at(c, i - 1));
+			at(c, offset) = std::move(value);
+		}
+	}
+	// removes the element at offset from a chunk whose last element is at
+	// last_index by shifting whichever side is shorter. returns the index
+	// of the slot that is now unused, which is either 0 or last_index. if
+	// it is 0 the caller has to move head forward
+	size_type remove_from_chunk(chunk & c, size_type offset, size_type last_index)
+	{
+		if (offset < last_index - offset)
+		{
+			for (size_type i = offset; i > 0; --i)
+				at(c, i) = std::move(at(c, i - 1));
+			if (last_index != mask()) return 0;
+			// a full chunk: the unused first slot becomes the last slot
+			c.head = (c.head + 1) & mask();
+			return last_index;
+		}
+		else
+		{
+			for (size_type i = offset; i < last_index; ++i)
+				at(c, i) = std::move(at(c, i + 1));
+			return last_index;
+		}
+	}
+
+	static size_type shift_for(size_type capacity)
+	{
+		size_type result = min_shift;
+		while ((size_type(1) << (2 * result)) < capacity)
+			++result;
+		return result;
+	}
+	size_type num_chunks_for(size_type capacity) const
+	{
+		return (capacity + mask()) >> shift;
+	}
+	size_type grown_capacity() const
+	{
+		return std::max(capacity() * 2, chunk_size());
+	}
+	// adds chunks until the capacity is at least new_capacity. if that
+	// would make more chunks than there are elements in a chunk, first
+	// moves everything into bigger chunks
+	void grow(size_type new_capacity)
+	{
+		size_type new_shift = shift_for(new_capacity);
+		if (new_shift > shift) rechunk(new_shift, new_capacity);
+		else
+		{
+			chunks.reserve(num_chunks_for(new_capacity));
+			while (capacity() < new_capacity)
+				chunks.push_back(chunk{ allocator_traits::allocate(allocator, chunk_size()), 0 });
+		}
+	}
+	// moves all elements into new chunks of size 2^new_shift. if a move
+	// throws the old chunks are left unchanged
+	void rechunk(size_type new_shift, size_type new_capacity)
+	{
+		size_type new_chunk_size = size_type(1) << new_shift;
+		std::vector<chunk, chunk_allocator> new_chunks((chunk_allocator(allocator)));
+		new_chunks.reserve((new_capacity + new_chunk_size - 1) >> new_shift);
+		size_type constructed = 0;
+		try
+		{
+			while ((new_chunks.size() << new_shift) < new_capacity)
+				new_chunks.push_back(chunk{ allocator_traits::allocate(allocator, new_chunk_size), 0 });
+			for (; constructed < num_elements; ++constructed)
+			{
+				T * out = new_chunks[constructed >> new_shift].elements + (constructed & (new_chunk_size - 1));
+				allocator_traits::construct(allocator, out, std::move_if_noexcept(element(constructed)));
+			}
+		}
+		catch(...)
+		{
+			for (size_type i = 0; i < constructed; ++i)
+				allocator_traits::destroy(allocator, new_chunks[i >> new_shift].elements + (i & (new_chunk_size - 1)));
+			for (chunk & c : new_chunks)
+				allocator_traits::deallocate(allocator, c.elements, new_chunk_size);
+			throw;
+		}
+		size_type size_before = num_elements;
+		clear();
+		deallocate_chunks(0);
+		chunks = std::move(new_chunks);
+		num_elements = size_before;
+		shift = new_shift;
+	}
+	// frees every chunk from first_unused on. those chunks have to be empty
+	void deallocate_chunks(size_type first_unused)
+	{
+		for (size_type i = first_unused; i < chunks.size(); ++i)
+			allocator_traits::deallocate(allocator, chunks[i].elements, chunk_size());
+		chunks.resize(first_unused);
+	}
+};
+
+template<typename T, typename A>
+void swap(tiered_vector<T, A> & lhs, tiered_vector<T, A> & rhs)
+{
+	lhs.swap(rhs);
+}